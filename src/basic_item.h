@@ -50,6 +50,9 @@ class basic_item
     using data_type = std::variant<
         std::monostate,
         bool,
+#ifdef JSON_USE_LONG_INTEGERS
+        std::int64_t,
+#endif
         double,
         typename traits_::array_type,
         typename traits_::object_type,
@@ -782,7 +785,9 @@ public:
     size_t operator()(bool)const { return 0; }
     size_t operator()(double)const { return 0; }
     size_t operator()(std::monostate)const { return 0; }
-    size_t operator()(std::uint64_t)const { return 0; }
+#ifdef JSON_USE_LONG_INTEGERS
+    size_t operator()(std::int64_t)const { return 0; }
+#endif
     size_t operator()(typename traits::string_type const& /*str*/)const { return 0; }
     size_t operator()(typename traits::array_type const& arr)const { return arr.size(); }
     size_t operator()(typename traits::object_type const& obj)const { return obj.size(); }
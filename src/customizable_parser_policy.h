@@ -6,30 +6,331 @@
 #ifndef JBC_LIBJSON_CUSTOMIZABLE_PARSER_POLICY_H
 #define JBC_LIBJSON_CUSTOMIZABLE_PARSER_POLICY_H
 
-#include <functional>
+#include "handler_result.h"
+#include "helper_functions.h"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
 
-template<typename string_type>
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * @brief The sax_events struct is a table of event functions, called with the context given along with the
+ * table. A null function is an event nobody subscribes to : it succeeds without any call.
+ */
+template<typename string_view>
+struct sax_events
+{
+    handler_result (*begin_array)(void* context) = nullptr;
+    bool (*end_array)(void* context) = nullptr;
+    handler_result (*begin_object)(void* context) = nullptr;
+    bool (*end_object)(void* context) = nullptr;
+    bool (*boolean)(void* context, bool value) = nullptr;
+    bool (*number)(void* context, double value) = nullptr;
+#ifdef JSON_USE_LONG_INTEGERS
+    bool (*integer)(void* context, int64_t value) = nullptr;
+#endif
+    bool (*null)(void* context) = nullptr;
+    bool (*begin_string)(void* context) = nullptr;
+    bool (*string_content)(void* context, string_view value) = nullptr;
+    bool (*end_string)(void* context) = nullptr;
+    bool (*begin_key)(void* context) = nullptr;
+    bool (*key_content)(void* context, string_view value) = nullptr;
+    handler_result (*end_key)(void* context) = nullptr;
+};
+
+namespace sax_detail
+{
+
+#define JBC_JSON_SAX_HAS(name, ...) \
+    template<typename A> static auto name##_(int) -> decltype(std::declval<A&>().name(__VA_ARGS__), std::true_type{}); \
+    template<typename A> static std::false_type name##_(...); \
+    static constexpr bool has_##name() { return decltype(name##_<access>(0))::value; }
+
+/**
+ * @brief The access struct reaches the handler functions of Handler, which callbacks policies declare protected :
+ * they are detected from a derived class, and called through pointers to members named by it
+ */
+template<typename Handler, typename string_view>
+struct access : Handler
+{
+    JBC_JSON_SAX_HAS(begin_array_handler)
+    JBC_JSON_SAX_HAS(end_array_handler)
+    JBC_JSON_SAX_HAS(begin_object_handler)
+    JBC_JSON_SAX_HAS(end_object_handler)
+    JBC_JSON_SAX_HAS(boolean_handler, true)
+    JBC_JSON_SAX_HAS(double_handler, 0.)
+#ifdef JSON_USE_LONG_INTEGERS
+    JBC_JSON_SAX_HAS(integer_handler, int64_t{0})
+#endif
+    JBC_JSON_SAX_HAS(null_handler)
+    JBC_JSON_SAX_HAS(begin_string_handler)
+    JBC_JSON_SAX_HAS(string_content_handler, std::declval<string_view>())
+    JBC_JSON_SAX_HAS(end_string_handler)
+    JBC_JSON_SAX_HAS(begin_key_handler)
+    JBC_JSON_SAX_HAS(key_content_handler, std::declval<string_view>())
+    JBC_JSON_SAX_HAS(end_key_handler)
+
+    /**
+     * @brief call_ calls function, a member of Handler or a static one, on the handler context points to
+     */
+    template<typename F, typename... Args>
+    static decltype(auto) call_(void* context, F function, Args... args)
+    {
+        if constexpr(std::is_member_function_pointer_v<F>)
+            return (static_cast<Handler*>(context)->*function)(args...);
+        else
+            return function(args...);
+    }
+
+    static handler_result begin_array(void* c) { return to_handler_result(call_(c, &access::begin_array_handler)); }
+    static bool end_array(void* c) { return call_(c, &access::end_array_handler); }
+    static handler_result begin_object(void* c) { return to_handler_result(call_(c, &access::begin_object_handler)); }
+    static bool end_object(void* c) { return call_(c, &access::end_object_handler); }
+    static bool boolean(void* c, bool v) { return call_(c, &access::boolean_handler, v); }
+    static bool number(void* c, double v) { return call_(c, &access::double_handler, v); }
+#ifdef JSON_USE_LONG_INTEGERS
+    static bool integer(void* c, int64_t v) { return call_(c, &access::integer_handler, v); }
+#endif
+    static bool null(void* c) { return call_(c, &access::null_handler); }
+    static bool begin_string(void* c) { return call_(c, &access::begin_string_handler); }
+    static bool string_content(void* c, string_view v) { return call_(c, &access::string_content_handler, v); }
+    static bool end_string(void* c) { return call_(c, &access::end_string_handler); }
+    static bool begin_key(void* c) { return call_(c, &access::begin_key_handler); }
+    static bool key_content(void* c, string_view v) { return call_(c, &access::key_content_handler, v); }
+    static handler_result end_key(void* c) { return to_handler_result(call_(c, &access::end_key_handler)); }
+};
+
+#undef JBC_JSON_SAX_HAS
+
+}
+
+/**
+ * @brief make_sax_events builds, at compile time, the table of the handler functions Handler provides, public or
+ * protected. They have the same names and signatures as the parser callbacks, so that a callbacks policy (such as
+ * stl_item_builder, or NullHandler in jsonbench) can also be plugged at runtime. Missing functions are left null.
+ */
+template<typename Handler, typename string_view>
+constexpr sax_events<string_view> make_sax_events()
+{
+    using A = sax_detail::access<Handler, string_view>;
+    sax_events<string_view> events;
+    if constexpr(A::has_begin_array_handler())
+        events.begin_array = &A::begin_array;
+    if constexpr(A::has_end_array_handler())
+        events.end_array = &A::end_array;
+    if constexpr(A::has_begin_object_handler())
+        events.begin_object = &A::begin_object;
+    if constexpr(A::has_end_object_handler())
+        events.end_object = &A::end_object;
+    if constexpr(A::has_boolean_handler())
+        events.boolean = &A::boolean;
+    if constexpr(A::has_double_handler())
+        events.number = &A::number;
+#ifdef JSON_USE_LONG_INTEGERS
+    if constexpr(A::has_integer_handler())
+        events.integer = &A::integer;
+#endif
+    if constexpr(A::has_null_handler())
+        events.null = &A::null;
+    if constexpr(A::has_begin_string_handler())
+        events.begin_string = &A::begin_string;
+    if constexpr(A::has_string_content_handler())
+        events.string_content = &A::string_content;
+    if constexpr(A::has_end_string_handler())
+        events.end_string = &A::end_string;
+    if constexpr(A::has_begin_key_handler())
+        events.begin_key = &A::begin_key;
+    if constexpr(A::has_key_content_handler())
+        events.key_content = &A::key_content;
+    if constexpr(A::has_end_key_handler())
+        events.end_key = &A::end_key;
+    static_assert(A::has_begin_array_handler() || A::has_end_array_handler() || A::has_begin_object_handler() ||
+                  A::has_end_object_handler() || A::has_boolean_handler() || A::has_double_handler() ||
+#ifdef JSON_USE_LONG_INTEGERS
+                  A::has_integer_handler() ||
+#endif
+                  A::has_null_handler() || A::has_begin_string_handler() || A::has_string_content_handler() ||
+                  A::has_end_string_handler() || A::has_begin_key_handler() || A::has_key_content_handler() ||
+                  A::has_end_key_handler(), "Handler provides no handler function");
+    return events;
+}
+
+/**
+ * The customizable_parser_policy class is a parser callbacks policy whose handlers are chosen at runtime, for
+ * plugin code : it dispatches every event through a single table of functions (see sax_events) and a context
+ * pointer. Events whose function is null cost a test, and no call. Without a handler, the document is only
+ * validated.
+ */
+template<typename string_type, typename char_type = typename string_type::value_type>
 class customizable_parser_policy
 {
 public:
-    std::function<bool()> begin_array_handler;
-    std::function<bool()> end_array_handler;
+    using string_view = decltype(helper_functions<string_type, char_type>::make_string_view(
+                                     std::declval<char_type const*>(), 0));
+    using events_type = sax_events<string_view>;
+
+    /**
+     * @brief set_handler sets the table of events, and the context given to them. Both must outlive the parsing.
+     */
+    void set_handler(events_type const* events, void* context);
+
+    /**
+     * @brief set_handler dispatches the events to the handler functions of handler, see make_sax_events
+     */
+    template<typename Handler>
+    void set_handler(Handler& handler);
 
-    std::function<bool()> begin_object_handler;
-    std::function<bool()> end_object_handler;
+    /**
+     * @brief clear_handler removes the handler : the document is only validated
+     */
+    void clear_handler();
 
-    std::function<bool(string_type &&)> string_handler;
-    std::function<bool(string_type &&)> key_handler;
+protected:
+    // ARRAY
+    handler_result begin_array_handler();
+    bool end_array_handler();
 
-    std::function<bool(double)> double_handler;
+    // OBJECT
+    handler_result begin_object_handler();
+    bool end_object_handler();
 
+    // SCALARS
+    bool boolean_handler(bool value);
+    bool double_handler(double value);
 #ifdef JSON_USE_LONG_INTEGERS
-    std::function<bool(int64_t)> integer_handler;
+    bool integer_handler(int64_t value);
 #endif
+    bool null_handler();
 
-    std::function<bool(bool)> boolean_handler;
+    // STRING
+    bool begin_string_handler();
+    bool string_content_handler(string_view value);
+    bool end_string_handler();
 
-    std::function<bool()> null_handler;
+    // KEY
+    bool begin_key_handler();
+    bool key_content_handler(string_view value);
+    handler_result end_key_handler();
+
+private:
+    static constexpr events_type no_events_{};
+    events_type const* events_ = &no_events_;
+    void* context_ = nullptr;
 };
 
-#endif // JBC_JSON_CUSTOMIZABLE_PARSER_POLICY_H
+template<typename string_type, typename char_type>
+void customizable_parser_policy<string_type, char_type>::set_handler(events_type const* events, void* context)
+{
+    events_ = events != nullptr ? events : &no_events_;
+    context_ = context;
+}
+
+template<typename string_type, typename char_type>
+template<typename Handler>
+void customizable_parser_policy<string_type, char_type>::set_handler(Handler& handler)
+{
+    static constexpr events_type events = make_sax_events<Handler, string_view>();
+    set_handler(&events, &handler);
+}
+
+template<typename string_type, typename char_type>
+void customizable_parser_policy<string_type, char_type>::clear_handler()
+{
+    set_handler(nullptr, nullptr);
+}
+
+template<typename string_type, typename char_type>
+handler_result customizable_parser_policy<string_type, char_type>::begin_array_handler()
+{
+    return events_->begin_array == nullptr ? handler_result::proceed : events_->begin_array(context_);
+}
+
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::end_array_handler()
+{
+    return events_->end_array == nullptr || events_->end_array(context_);
+}
+
+template<typename string_type, typename char_type>
+handler_result customizable_parser_policy<string_type, char_type>::begin_object_handler()
+{
+    return events_->begin_object == nullptr ? handler_result::proceed : events_->begin_object(context_);
+}
+
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::end_object_handler()
+{
+    return events_->end_object == nullptr || events_->end_object(context_);
+}
+
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::boolean_handler(bool value)
+{
+    return events_->boolean == nullptr || events_->boolean(context_, value);
+}
+
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::double_handler(double value)
+{
+    return events_->number == nullptr || events_->number(context_, value);
+}
+
+#ifdef JSON_USE_LONG_INTEGERS
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::integer_handler(int64_t value)
+{
+    return events_->integer == nullptr || events_->integer(context_, value);
+}
+#endif
+
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::null_handler()
+{
+    return events_->null == nullptr || events_->null(context_);
+}
+
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::begin_string_handler()
+{
+    return events_->begin_string == nullptr || events_->begin_string(context_);
+}
+
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::string_content_handler(string_view value)
+{
+    return events_->string_content == nullptr || events_->string_content(context_, value);
+}
+
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::end_string_handler()
+{
+    return events_->end_string == nullptr || events_->end_string(context_);
+}
+
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::begin_key_handler()
+{
+    return events_->begin_key == nullptr || events_->begin_key(context_);
+}
+
+template<typename string_type, typename char_type>
+bool customizable_parser_policy<string_type, char_type>::key_content_handler(string_view value)
+{
+    return events_->key_content == nullptr || events_->key_content(context_, value);
+}
+
+template<typename string_type, typename char_type>
+handler_result customizable_parser_policy<string_type, char_type>::end_key_handler()
+{
+    return events_->end_key == nullptr ? handler_result::proceed : events_->end_key(context_);
+}
+
+}
+}
+
+#endif // JBC_LIBJSON_CUSTOMIZABLE_PARSER_POLICY_H
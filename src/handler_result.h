@@ -0,0 +1,45 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_HANDLER_RESULT_H
+#define JBC_JSON_HANDLER_RESULT_H
+
+#include <cstdint>
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * @brief The handler_result enum can be returned, instead of a bool, by begin_array_handler, begin_object_handler
+ * and end_key_handler. With skip, the parser fast forwards over the array or object that begins, or over the
+ * value of the key that ends, without calling any handler for it (not even the end handler of the skipped
+ * container). Skipped values are only checked for balanced brackets and terminated strings.
+ */
+enum class handler_result : std::uint8_t
+{
+    fail = 0 /**< the handler failed, parsing stops with an error */,
+    proceed = 1 /**< the handler succeeded */,
+    skip = 2 /**< skip the value */
+};
+
+/**
+ * @brief to_handler_result converts the result of a handler, returning either a bool or a handler_result
+ */
+constexpr handler_result to_handler_result(bool good)
+{
+    return good ? handler_result::proceed : handler_result::fail;
+}
+
+constexpr handler_result to_handler_result(handler_result result)
+{
+    return result;
+}
+
+}
+}
+
+#endif // JBC_JSON_HANDLER_RESULT_H
@@ -6,9 +6,22 @@
 #ifndef JBC_JSON_HELPER_FUNCTIONS_H
 #define JBC_JSON_HELPER_FUNCTIONS_H
 
-#include <string> // for std::strtoll
-#include <cerrno> // for errno
+#include <algorithm>
+#include <charconv> // for std::from_chars
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__GNUC__)
+#define JBC_JSON_ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define JBC_JSON_ALWAYS_INLINE __forceinline
+#else
+#define JBC_JSON_ALWAYS_INLINE inline
+#endif
 
 namespace jbc
 {
@@ -24,6 +37,45 @@ enum class SpecialChar
     Tab
 };
 
+/**
+ * @brief has_reset tells whether T provides a reset() member function. Parsers use it to reset their callbacks
+ * along with their own state.
+ */
+template<typename T, typename = void>
+struct has_reset : std::false_type {};
+
+template<typename T>
+struct has_reset<T, std::void_t<decltype(std::declval<T&>().reset())> > : std::true_type {};
+
+/**
+ * @brief has_clear tells whether T provides a clear() member function, which strings that own their characters do,
+ * and views do not
+ */
+template<typename T, typename = void>
+struct has_clear : std::false_type {};
+
+template<typename T>
+struct has_clear<T, std::void_t<decltype(std::declval<T&>().clear())> > : std::true_type {};
+
+/**
+ * @brief has_exact_integer_handler tells whether T provides exact_integer_handler(bool negative, std::uint64_t
+ * magnitude). Parsers then give it every integral number whose magnitude fits 64 bits, instead of integer_handler
+ * or double_handler. Callbacks policies declare their handlers protected, so it is detected from a derived class.
+ */
+template<typename T>
+struct has_exact_integer_handler
+{
+private:
+    struct access : T
+    {
+        template<typename A> static auto test_(int) ->
+            decltype(std::declval<A&>().exact_integer_handler(false, std::uint64_t{0}), std::true_type{});
+        template<typename A> static std::false_type test_(...);
+    };
+public:
+    static constexpr bool value = decltype(access::template test_<access>(0))::value;
+};
+
 /**
  * @brief The json_helper_functions is a class used to provide some static methods that depends on the
  * actual buffer_type and char_type.
@@ -34,6 +86,11 @@ enum class SpecialChar
 template<typename buffer_type_, typename char_type>
 struct helper_functions
 {
+    /**
+     * @brief size of the stack buffer used to convert numbers made of non char characters
+     */
+    static constexpr std::ptrdiff_t number_buffer_size = 64;
+
     /**
      * @brief This function has the same semantics as std::string.push_back()
      */
@@ -65,22 +122,84 @@ struct helper_functions
     /**
      * @brief returns the integer value from the string value
      */
-    static std::pair<bool, int64_t> string_to_integer(buffer_type_ /*const*/& ref) {
-        std::pair<bool, int64_t> result;
-        errno = 0;
-        append_code_point(ref, 0);
-        result.second = std::strtoll(&ref.front(), nullptr, 10);
-        result.first = errno == 0;
+    static std::pair<bool, int64_t> string_to_integer(buffer_type_ const& ref) {
+        return chars_to_integer(ref.data(), ref.data() + ref.size());
+    }
+    static std::pair<bool, double> string_to_double(buffer_type_ const& ref)
+    {
+        return chars_to_double(ref.data(), ref.data() + ref.size());
+    }
+    /**
+     * @brief returns the integer value of [first, last), which must be entirely made of the number.
+     * Does not allocate, and does not depend on the current locale
+     */
+    static std::pair<bool, int64_t> chars_to_integer(char_type const* first, char_type const* last)
+    {
+        std::pair<bool, int64_t> result{false, 0};
+        if constexpr(std::is_same_v<char_type, char>)
+        {
+            auto res = std::from_chars(first, last, result.second);
+            result.first = res.ec == std::errc{} && res.ptr == last;
+        }
+        else
+        {
+            if(last - first <= number_buffer_size)
+            {
+                char buf[number_buffer_size];
+                std::copy(first, last, buf);
+                return helper_functions<std::string, char>::chars_to_integer(buf, buf + (last - first));
+            }
+        }
+        return result;
+    }
+    /**
+     * @brief returns the magnitude of [first, last), which must be entirely made of the number, if it is an integral
+     * number whose magnitude fits 64 bits. Does not allocate, and does not depend on the current locale
+     */
+    static std::pair<bool, std::uint64_t> chars_to_magnitude(char_type const* first, char_type const* last)
+    {
+        std::pair<bool, std::uint64_t> result{false, 0};
+        if constexpr(std::is_same_v<char_type, char>)
+        {
+            if(first != last && *first == '-')
+                ++first;
+            auto res = std::from_chars(first, last, result.second); // no sign for unsigned types
+            result.first = first != last && res.ec == std::errc{} && res.ptr == last;
+        }
+        else
+        {
+            if(last - first <= number_buffer_size)
+            {
+                char buf[number_buffer_size];
+                std::copy(first, last, buf);
+                return helper_functions<std::string, char>::chars_to_magnitude(buf, buf + (last - first));
+            }
+        }
         return result;
     }
-    static std::pair<bool, double> string_to_double(buffer_type_ /*const*/& ref)
+    /**
+     * @brief returns the double value of [first, last), which must be entirely made of the number.
+     * Does not allocate, and does not depend on the current locale
+     */
+    static std::pair<bool, double> chars_to_double(char_type const* first, char_type const* last)
     {
-        std::pair<bool, double> result;
-        errno = 0;
-        char_type* ret = nullptr;
-        std::string s{ref.begin(),ref.end()};
-        result.second = std::strtod(s.c_str(), &ret);
-        result.first = errno == 0 && ret == (s.c_str() + s.size());
+        std::pair<bool, double> result{false, 0.};
+        if constexpr(std::is_same_v<char_type, char>)
+        {
+            auto res = std::from_chars(first, last, result.second);
+            result.first = res.ec == std::errc{} && res.ptr == last;
+        }
+        else
+        {
+            if(last - first <= number_buffer_size)
+            {
+                char buf[number_buffer_size];
+                std::copy(first, last, buf);
+                return helper_functions<std::string, char>::chars_to_double(buf, buf + (last - first));
+            }
+            std::string s{first, last};
+            return helper_functions<std::string, char>::chars_to_double(s.data(), s.data() + s.size());
+        }
         return result;
     }
 
@@ -8,6 +8,7 @@
 
 #include "parser.h"
 #include "basic_item.h"
+#include "parser_limits.h"
 
 namespace jbc
 {
@@ -28,6 +29,27 @@ protected:
 
     State state_ = State::Initial;
 
+    /**
+     * @brief dom_bytes_ approximates the memory used by the item being built : the size of every item, plus the
+     * content of strings and keys
+     */
+    std::size_t dom_bytes_ = 0;
+    std::size_t max_dom_bytes_ = parser_limits::effective(0);
+    parse_error limit_error_ = parse_error::none;
+
+    /**
+     * @brief add_dom_bytes_ accounts for size more bytes in the item being built
+     * @return false if the maximum size is exceeded
+     */
+    bool add_dom_bytes_(std::size_t size)
+    {
+        dom_bytes_ += size;
+        if(dom_bytes_ <= max_dom_bytes_)
+            return true;
+        limit_error_ = parse_error::dom_size_limit;
+        return false;
+    }
+
     // ARRAY
     bool begin_array_handler();
 
@@ -86,6 +108,23 @@ public:
      * @param dest the destination to move into.
      */
     void moveTo(Item_ & dest);
+
+    /**
+     * @brief reset discards the item being built, so that the builder can be used for another document. The
+     * stack of items being built keeps its capacity.
+     */
+    void reset();
+
+    /**
+     * @brief set_limits sets the maximum size of the built item, see parser_limits::max_dom_bytes
+     */
+    void set_limits(parser_limits const& limits);
+
+    /**
+     * @brief limit_error tells which limit made a handler fail
+     * @return parse_error::none if no limit was reached
+     */
+    parse_error limit_error() const;
 };
 
 template<template<class> class container,typename Item_>
@@ -97,6 +136,8 @@ item_builder<container, Item_>::item_builder()
 template<template<class> class container,typename Item_>
 bool item_builder<container, Item_>::begin_array_handler()
 {
+    if((item_.type() == ItemType::Null || current_item_.back()->type() == ItemType::Array) && !add_dom_bytes_(sizeof(Item_)))
+        return false;
     if(item_.type() == ItemType::Null)
     {
         item_.morph_to(ItemType::Array);
@@ -124,6 +165,8 @@ bool item_builder<container, Item_>::end_array_handler()
 template<template<class> class container,typename Item_>
 bool item_builder<container, Item_>::begin_object_handler()
 {
+    if((item_.type() == ItemType::Null || current_item_.back()->type() == ItemType::Array) && !add_dom_bytes_(sizeof(Item_)))
+        return false;
     if(item_.type() == ItemType::Null)
     {
         item_.morph_to(ItemType::Object);
@@ -153,6 +196,8 @@ bool item_builder<container, Item_>::boolean_handler(bool value)
 {
     if(current_item_.back()->type() == ItemType::Array)
     {
+        if(!add_dom_bytes_(sizeof(Item_)))
+            return false;
         Item_* item = current_item_.back()->create_item(ItemType::Boolean);
         item->set_bool_value(value);
         return true;
@@ -169,6 +214,8 @@ bool item_builder<container, Item_>::double_handler(double value)
 {
     if(current_item_.back()->type() == ItemType::Array)
     {
+        if(!add_dom_bytes_(sizeof(Item_)))
+            return false;
         Item_* item = current_item_.back()->create_item(ItemType::Double);
         item->set_double_value(value);
         return true;
@@ -186,13 +233,15 @@ bool item_builder<container, Item_>::integer_handler(int64_t value)
 {
     if(current_item_.back()->type() == ItemType::Array)
     {
+        if(!add_dom_bytes_(sizeof(Item_)))
+            return false;
         Item_* item = current_item_.back()->create_item(ItemType::Integer);
-        item->setIntegerValue(value);
+        item->set_integer_value(value);
         return true;
     }
     // else ItemType::Object
     current_item_.back()->morph_to(ItemType::Integer);
-    current_item_.back()->setIntegerValue(value);
+    current_item_.back()->set_integer_value(value);
     current_item_.pop_back();
     return true;
 }
@@ -204,6 +253,8 @@ bool item_builder<container, Item_>::null_handler()
 {
     if(current_item_.back()->type() == ItemType::Array)
     {
+        if(!add_dom_bytes_(sizeof(Item_)))
+            return false;
         current_item_.back()->create_item(ItemType::Null);
         return true;
     }
@@ -215,6 +266,8 @@ bool item_builder<container, Item_>::null_handler()
 template<template<class> class container,typename Item_>
 bool item_builder<container, Item_>::begin_string_handler()
 {
+    if((item_.type() == ItemType::Null || current_item_.back()->type() == ItemType::Array) && !add_dom_bytes_(sizeof(Item_)))
+        return false;
     if(item_.type() == ItemType::Null)
     {
         using string = typename Item_::traits::string_type;
@@ -250,6 +303,8 @@ template<template<class> class container,typename Item_>
 bool item_builder<container, Item_>::string_content_handler(typename Item_::traits::string_view value)
 {
     using namespace std;
+    if(!add_dom_bytes_(value.size() * sizeof(typename Item_::traits::char_type)))
+        return false;
     typename Item_::traits::string_type & s = current_item_.back()->string_value();
     helper_functions<typename Item_::traits::buffer_type, typename Item_::traits::char_type>::
             append(s, begin(value), end(value));
@@ -275,6 +330,9 @@ bool item_builder<container, Item_>::key_content_handler(typename Item_::traits:
 template<template<class> class container,typename Item_>
 bool item_builder<container, Item_>::end_key_handler()
 {
+    if(!add_dom_bytes_(sizeof(typename Item_::traits::object_type::value_type) +
+                       lastString_.size() * sizeof(typename Item_::traits::char_type)))
+        return false;
     Item_* item = current_item_.back()->create_property(std::move(lastString_));
     current_item_.push_back(item);
     lastString_.clear();
@@ -293,6 +351,33 @@ void item_builder<container, Item_>::moveTo(Item_ & destination)
     destination = std::move(item_);
 }
 
+template<template<class> class container,typename Item_>
+void item_builder<container, Item_>::reset()
+{
+    item_ = Item_();
+    current_item_.clear();
+    current_item_.push_back(&item_);
+    if constexpr(has_clear<typename Item_::traits::string_type>::value)
+        lastString_.clear(); // keeps the capacity
+    else
+        lastString_ = typename Item_::traits::string_type();
+    state_ = State::Initial;
+    dom_bytes_ = 0;
+    limit_error_ = parse_error::none;
+}
+
+template<template<class> class container,typename Item_>
+void item_builder<container, Item_>::set_limits(parser_limits const& limits)
+{
+    max_dom_bytes_ = parser_limits::effective(limits.max_dom_bytes);
+}
+
+template<template<class> class container,typename Item_>
+parse_error item_builder<container, Item_>::limit_error() const
+{
+    return limit_error_;
+}
+
 }
 }
 
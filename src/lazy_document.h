@@ -0,0 +1,582 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_LAZY_DOCUMENT_H
+#define JBC_JSON_LAZY_DOCUMENT_H
+
+#include "stl_json.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace jbc
+{
+namespace json
+{
+
+class lazy_document;
+class lazy_iterator;
+
+namespace lazy_document_detail
+{
+
+/**
+ * @brief The tape_entry struct is a value of a lazy_document
+ */
+struct tape_entry
+{
+    std::uint32_t offset; /**< offset of the first character of the value */
+    /** for arrays and objects, index of the entry after the container. For strings and keys, offset of the closing
+     * quote. 0 otherwise */
+    std::uint32_t extra;
+};
+
+/**
+ * @brief The decoder struct receives the strings and numbers decoded on access
+ */
+struct decoder
+{
+    std::string text;
+    double double_value = 0.;
+#ifdef JSON_USE_LONG_INTEGERS
+    int64_t integer_value = 0;
+    bool integer = false;
+#endif
+
+    bool begin_array_handler() { return true; }
+    bool end_array_handler() { return true; }
+    bool begin_object_handler() { return true; }
+    bool end_object_handler() { return true; }
+    bool boolean_handler(bool) { return true; }
+    bool double_handler(double v)
+    {
+        double_value = v;
+#ifdef JSON_USE_LONG_INTEGERS
+        integer = false;
+#endif
+        return true;
+    }
+#ifdef JSON_USE_LONG_INTEGERS
+    bool integer_handler(int64_t v)
+    {
+        integer_value = v;
+        integer = true;
+        return true;
+    }
+#endif
+    bool null_handler() { return true; }
+    bool begin_string_handler() { text.clear(); return true; }
+    bool string_content_handler(std::string_view v) { text.append(v); return true; }
+    bool end_string_handler() { return true; }
+    bool begin_key_handler() { text.clear(); return true; }
+    bool key_content_handler(std::string_view v) { text.append(v); return true; }
+    bool end_key_handler() { return true; }
+};
+
+/**
+ * @brief The tape_parser class builds the tape of a lazy_document from the index of the structural_parser, and
+ * decodes its strings and numbers on demand, with the structural_parser functions
+ */
+class tape_parser : public structural_parser<stdvector, decoder, std::vector<char>, char>
+{
+    std::vector<std::uint32_t> open_; // tape index of the opened containers
+    void close_(std::vector<tape_entry>& tape);
+
+public:
+    /**
+     * @brief parse_tape checks the structure of the document, and fills tape with its values
+     */
+    bool parse_tape(char* begin, char* end, std::vector<tape_entry>& tape);
+    /**
+     * @brief decode_string decodes the escape sequences of [first, last) into decoder::text
+     */
+    bool decode_string(char* first, char* last);
+    /**
+     * @brief decode_number checks and converts the number [first, last)
+     */
+    bool decode_number(char* first, char* last);
+    static bool is_scalar_end(char c) { return is_scalar_end_(c); }
+};
+
+inline void tape_parser::close_(std::vector<tape_entry>& tape)
+{
+    stack_.pop_back();
+    tape[open_.back()].extra = static_cast<std::uint32_t>(tape.size());
+    open_.pop_back();
+}
+
+inline bool tape_parser::parse_tape(char* begin, char* end, std::vector<tape_entry>& tape)
+{
+    error_ = false;
+    complete_ = false;
+    err_ = nullptr;
+    tape.clear();
+    stack_.clear();
+    open_.clear();
+    if(static_cast<std::uint64_t>(end - begin) >= std::numeric_limits<std::uint32_t>::max())
+        return make_error("Document too large for structural index");
+    if(!build_index_(begin, end))
+        return false;
+    std::size_t const count = indexes_.size();
+    if(count == 0)
+        return make_error("Empty document");
+    char const first = begin[indexes_[0]];
+    if(first != '{' && first != '[' && first != '"')
+        return make_error("Invalid token in Initial");
+    tape.reserve(count / 2 + 1);
+    Expect expect = Expect::Value;
+    std::size_t i = 0;
+    while(i < count)
+    {
+        std::uint32_t const offset = indexes_[i];
+        char* cur = begin + offset;
+        switch(expect)
+        {
+            case Expect::FirstArrayValue:
+                if(*cur == ']')
+                {
+                    ++i;
+                    close_(tape);
+                    expect = after_value_();
+                    break;
+                }
+                [[fallthrough]];
+            case Expect::Value:
+                ++i;
+                if(*cur == '{' || *cur == '[')
+                {
+                    open_.push_back(static_cast<std::uint32_t>(tape.size()));
+                    tape.push_back(tape_entry{offset, 0});
+                    stack_.push_back(*cur == '{');
+                    expect = *cur == '{' ? Expect::FirstKey : Expect::FirstArrayValue;
+                    break;
+                }
+                if(*cur == '"')
+                {
+                    // inside a string, nothing is indexed : the next index is the closing quote
+                    tape.push_back(tape_entry{offset, indexes_[i]});
+                    ++i;
+                }
+                else if(*cur == 't' || *cur == 'n')
+                {
+                    if(end - cur < 4 || std::memcmp(cur, *cur == 't' ? "true" : "null", 4) != 0 ||
+                            (end - cur > 4 && !is_scalar_end_(cur[4])))
+                        return make_error("Invalid literal");
+                    tape.push_back(tape_entry{offset, 0});
+                }
+                else if(*cur == 'f')
+                {
+                    if(end - cur < 5 || std::memcmp(cur, "false", 5) != 0 || (end - cur > 5 && !is_scalar_end_(cur[5])))
+                        return make_error("Invalid literal, expected false");
+                    tape.push_back(tape_entry{offset, 0});
+                }
+                else if(*cur == '-' || (*cur >= '0' && *cur <= '9'))
+                    tape.push_back(tape_entry{offset, 0}); // checked when decoded
+                else
+                    return make_error("Unexpected token, expected a value");
+                expect = after_value_();
+                break;
+            case Expect::FirstKey:
+                if(*cur == '}')
+                {
+                    ++i;
+                    close_(tape);
+                    expect = after_value_();
+                    break;
+                }
+                [[fallthrough]];
+            case Expect::Key:
+                if(*cur != '"')
+                    return make_error("Unexpected token, expected a key");
+                tape.push_back(tape_entry{offset, indexes_[i + 1]});
+                i += 2;
+                if(i >= count || begin[indexes_[i]] != ':')
+                    return make_error("Unexpected token in ObjectKey");
+                ++i;
+                expect = Expect::Value;
+                break;
+            case Expect::ArrayNext:
+                ++i;
+                if(*cur == ',')
+                    expect = Expect::Value;
+                else if(*cur == ']')
+                {
+                    close_(tape);
+                    expect = after_value_();
+                }
+                else
+                    return make_error("Unexpected token in Array");
+                break;
+            case Expect::ObjectNext:
+                ++i;
+                if(*cur == ',')
+                    expect = Expect::Key;
+                else if(*cur == '}')
+                {
+                    close_(tape);
+                    expect = after_value_();
+                }
+                else
+                    return make_error("Unexpected token in ObjectValue");
+                break;
+            case Expect::Done:
+                return make_error("Extra data after document");
+        }
+    }
+    if(expect != Expect::Done)
+        return make_error("Unexpected end of document");
+    complete_ = true;
+    return true;
+}
+
+inline bool tape_parser::decode_string(char* first, char* last)
+{
+    return string_(first, last, false);
+}
+
+inline bool tape_parser::decode_number(char* first, char* last)
+{
+    return number_(first, last);
+}
+
+}
+
+/**
+ * The lazy_value class is a value of a lazy_document : a position in its tape. It is cheap to copy, and only
+ * valid as long as the document is not parsed again. A missing value, such as the result of looking up a key that
+ * does not exist, does not exist, and its lookups return missing values too.
+ */
+class lazy_value
+{
+    friend class lazy_document;
+    friend class lazy_iterator;
+
+    lazy_document const* doc_ = nullptr;
+    std::uint32_t index_ = 0;
+
+    lazy_value(lazy_document const* doc, std::uint32_t index) : doc_(doc), index_(index) {}
+    lazy_value item_(std::size_t index) const;
+
+public:
+    lazy_value() = default;
+
+    /**
+     * @brief exists tells whether this is a value of the document, or a missing value
+     */
+    bool exists() const { return doc_ != nullptr; }
+    /**
+     * @brief type returns the type of the value, Null if missing. Numbers are Double, or Integer if they are
+     * integral and JSON_USE_LONG_INTEGERS is defined.
+     */
+    ItemType type() const;
+
+    /**
+     * @brief bool_value returns the value of a boolean
+     * @return false in first if the value is not a boolean
+     */
+    std::pair<bool, bool> bool_value() const;
+    /**
+     * @brief double_value decodes a number
+     * @return false in first if the value is not a number, or is not a valid number
+     */
+    std::pair<bool, double> double_value() const;
+    /**
+     * @brief integer_value decodes an integral number
+     * @return false in first if the value is not a valid integral number, or does not fit
+     */
+    std::pair<bool, int64_t> integer_value() const;
+    /**
+     * @brief string_value decodes a string. Strings without escape sequences are not copied : the view points
+     * into the parsed buffer. Otherwise, it points into a buffer of the document, valid until the next string
+     * with escape sequences is decoded.
+     * @return false in first if the value is not a string, or is not a valid string
+     */
+    std::pair<bool, std::string_view> string_value() const;
+
+    /**
+     * @brief child_count returns the number of items of an array, or of properties of an object. Linear in
+     * the number of children.
+     */
+    std::size_t child_count() const;
+    /**
+     * @brief operator [] returns the value of the first property named key, or a missing value. Linear in the
+     * number of properties before it.
+     */
+    lazy_value operator[](std::string_view key) const;
+    lazy_value operator[](char const* key) const { return (*this)[std::string_view(key)]; }
+    /**
+     * @brief operator [] returns the item at index of an array, or a missing value. Linear in index. Any integral
+     * type is accepted, so that a literal 0 is not taken as a null key.
+     */
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T> > >
+    lazy_value operator[](T index) const { return item_(static_cast<std::size_t>(index)); }
+
+    /**
+     * @brief begin returns an iterator on the items of an array, or on the properties of an object
+     */
+    lazy_iterator begin() const;
+    lazy_iterator end() const;
+};
+
+/**
+ * The lazy_iterator class is a forward iterator on the items of an array, or on the properties of an object.
+ * Dereferencing it gives the item or the value of the property. It is only valid as long as the document is not
+ * parsed again.
+ */
+class lazy_iterator
+{
+    friend class lazy_value;
+
+    lazy_document const* doc_ = nullptr;
+    std::uint32_t index_ = 0; // item, or key of the property
+    bool object_ = false;
+
+    lazy_iterator(lazy_document const* doc, std::uint32_t index, bool object) :
+        doc_(doc), index_(index), object_(object) {}
+
+public:
+    lazy_iterator() = default;
+
+    lazy_value operator*() const { return lazy_value(doc_, object_ ? index_ + 1 : index_); }
+    /**
+     * @brief key returns the key of the property, as lazy_value::string_value
+     */
+    std::pair<bool, std::string_view> key() const { return lazy_value(doc_, index_).string_value(); }
+    lazy_iterator& operator++();
+    bool operator==(lazy_iterator const& other) const { return index_ == other.index_ && doc_ == other.doc_; }
+    bool operator!=(lazy_iterator const& other) const { return !(*this == other); }
+};
+
+/**
+ * The lazy_document class parses a document that is entirely available in memory into a tape : one entry of two
+ * offsets per value, in document order, where arrays and objects know where they end. Strings and numbers are
+ * only decoded when accessed, so reading a few values of a large document avoids building the whole item tree.
+ *
+ * Parsing checks the structure of the document and its literals. Strings and numbers are checked when decoded,
+ * their accessors then fail. The buffer must outlive the document, and must not be modified. A document is not
+ * thread safe, even when only reading, because decoding uses a buffer of the document.
+ */
+class lazy_document
+{
+    friend class lazy_value;
+    friend class lazy_iterator;
+
+    char* begin_ = nullptr;
+    char* end_ = nullptr;
+    std::vector<lazy_document_detail::tape_entry> tape_;
+    mutable lazy_document_detail::tape_parser parser_;
+
+    bool is_container_(std::uint32_t index) const
+    {
+        char const c = begin_[tape_[index].offset];
+        return c == '{' || c == '[';
+    }
+    std::uint32_t next_(std::uint32_t index) const
+    {
+        return is_container_(index) ? tape_[index].extra : index + 1;
+    }
+    char* number_end_(char* first) const;
+
+public:
+    /**
+     * @brief parse parses a complete document. Previous values and iterators are invalidated.
+     * @return true if the document is valid
+     */
+    bool parse(char* begin, char* end);
+
+    /**
+     * @brief root returns the top level value, a missing value if the last parse failed
+     */
+    lazy_value root() const;
+    lazy_value operator[](std::string_view key) const { return root()[key]; }
+    lazy_value operator[](char const* key) const { return root()[std::string_view(key)]; }
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T> > >
+    lazy_value operator[](T index) const { return root()[index]; }
+
+    /**
+     * @brief tape_size returns the number of values of the document, keys included
+     */
+    std::size_t tape_size() const { return tape_.size(); }
+
+    /**
+     * @brief error_message returns the reason why the last parse or decoding failed
+     * @return null pointer if no error, pointer to a NULL terminated string otherwise.
+     */
+    char const* error_message() const { return parser_.error_message(); }
+};
+
+inline bool lazy_document::parse(char* begin, char* end)
+{
+    begin_ = begin;
+    end_ = end;
+    if(parser_.parse_tape(begin, end, tape_))
+        return true;
+    tape_.clear();
+    return false;
+}
+
+inline lazy_value lazy_document::root() const
+{
+    return tape_.empty() ? lazy_value() : lazy_value(this, 0);
+}
+
+inline char* lazy_document::number_end_(char* first) const
+{
+    char* last = first;
+    while(last != end_ && !lazy_document_detail::tape_parser::is_scalar_end(*last))
+        ++last;
+    return last;
+}
+
+inline ItemType lazy_value::type() const
+{
+    if(doc_ == nullptr)
+        return ItemType::Null;
+    char* const first = doc_->begin_ + doc_->tape_[index_].offset;
+    switch(*first)
+    {
+        case '{': return ItemType::Object;
+        case '[': return ItemType::Array;
+        case '"': return ItemType::String;
+        case 't': case 'f': return ItemType::Boolean;
+        case 'n': return ItemType::Null;
+        default: break;
+    }
+#ifdef JSON_USE_LONG_INTEGERS
+    char* const last = doc_->number_end_(first);
+    if(std::find_if(first, last, [](char c) { return c == '.' || c == 'e' || c == 'E'; }) == last)
+        return ItemType::Integer;
+#endif
+    return ItemType::Double;
+}
+
+inline std::pair<bool, bool> lazy_value::bool_value() const
+{
+    if(doc_ == nullptr)
+        return {false, false};
+    char const c = doc_->begin_[doc_->tape_[index_].offset];
+    return {c == 't' || c == 'f', c == 't'};
+}
+
+inline std::pair<bool, double> lazy_value::double_value() const
+{
+    ItemType const t = type();
+    if(t != ItemType::Double
+#ifdef JSON_USE_LONG_INTEGERS
+            && t != ItemType::Integer
+#endif
+            )
+        return {false, 0.};
+    char* const first = doc_->begin_ + doc_->tape_[index_].offset;
+    char* const last = doc_->number_end_(first);
+    if(!doc_->parser_.decode_number(first, last))
+        return {false, 0.};
+#ifdef JSON_USE_LONG_INTEGERS
+    if(doc_->parser_.integer)
+        return {true, static_cast<double>(doc_->parser_.integer_value)};
+#endif
+    return {true, doc_->parser_.double_value};
+}
+
+inline std::pair<bool, int64_t> lazy_value::integer_value() const
+{
+    if(!double_value().first) // checks the number grammar
+        return {false, 0};
+    char* const first = doc_->begin_ + doc_->tape_[index_].offset;
+    return helper_functions<std::vector<char>, char>::chars_to_integer(first, doc_->number_end_(first));
+}
+
+inline std::pair<bool, std::string_view> lazy_value::string_value() const
+{
+    if(doc_ == nullptr)
+        return {false, std::string_view()};
+    lazy_document_detail::tape_entry const& entry = doc_->tape_[index_];
+    char* const first = doc_->begin_ + entry.offset;
+    if(*first != '"')
+        return {false, std::string_view()};
+    char* const last = doc_->begin_ + entry.extra;
+    if(scan_helper<char>::find_string_special(first + 1, last) == last)
+        return {true, std::string_view(first + 1, static_cast<std::size_t>(last - first - 1))};
+    if(!doc_->parser_.decode_string(first + 1, last))
+        return {false, std::string_view()};
+    return {true, std::string_view(doc_->parser_.text)};
+}
+
+inline std::size_t lazy_value::child_count() const
+{
+    std::size_t count = 0;
+    for(lazy_iterator it = begin(), e = end(); it != e; ++it)
+        ++count;
+    return count;
+}
+
+inline lazy_value lazy_value::operator[](std::string_view key) const
+{
+    if(type() != ItemType::Object)
+        return lazy_value();
+    for(lazy_iterator it = begin(), e = end(); it != e; ++it)
+    {
+        lazy_document_detail::tape_entry const& entry = doc_->tape_[it.index_];
+        char const* const first = doc_->begin_ + entry.offset + 1;
+        std::size_t const size = entry.extra - entry.offset - 1;
+        if(std::memchr(first, '\\', size) == nullptr) // compare in place
+        {
+            if(size == key.size() && std::memcmp(first, key.data(), size) == 0)
+                return *it;
+        }
+        else
+        {
+            auto name = it.key();
+            if(name.first && name.second == key)
+                return *it;
+        }
+    }
+    return lazy_value();
+}
+
+inline lazy_value lazy_value::item_(std::size_t index) const
+{
+    if(type() != ItemType::Array)
+        return lazy_value();
+    for(lazy_iterator it = begin(), e = end(); it != e; ++it, --index)
+    {
+        if(index == 0)
+            return *it;
+    }
+    return lazy_value();
+}
+
+inline lazy_iterator lazy_value::begin() const
+{
+    ItemType const t = type();
+    if(t != ItemType::Object && t != ItemType::Array)
+        return lazy_iterator();
+    return lazy_iterator(doc_, index_ + 1, t == ItemType::Object);
+}
+
+inline lazy_iterator lazy_value::end() const
+{
+    ItemType const t = type();
+    if(t != ItemType::Object && t != ItemType::Array)
+        return lazy_iterator();
+    return lazy_iterator(doc_, doc_->tape_[index_].extra, t == ItemType::Object);
+}
+
+inline lazy_iterator& lazy_iterator::operator++()
+{
+    index_ = doc_->next_(object_ ? index_ + 1 : index_);
+    return *this;
+}
+
+}
+}
+
+#endif // JBC_JSON_LAZY_DOCUMENT_H
@@ -0,0 +1,114 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_MAPPED_FILE_H
+#define JBC_JSON_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JBC_JSON_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * The mapped_file class maps a whole regular file in memory, read only, so that it can be parsed with a single
+ * call to consume(begin, end), without any copy. Pipes, devices, empty files, and platforms without mmap are
+ * not mapped : is_open() is then false, and the caller is expected to fall back to reading the file.
+ */
+class mapped_file
+{
+    char* data_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    /**
+     * @brief mapped_file maps the file
+     * @param path path of the file
+     * @param huge_pages also asks for transparent huge pages, where the system supports them for the mapping
+     */
+    explicit mapped_file(std::string const& path, bool huge_pages = false);
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+    ~mapped_file();
+
+    /**
+     * @brief is_open tells whether the file is mapped
+     */
+    bool is_open() const;
+    char* begin() const;
+    char* end() const;
+    std::size_t size() const;
+};
+
+inline mapped_file::mapped_file(std::string const& path, bool huge_pages)
+{
+#ifdef JBC_JSON_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+    struct stat st;
+    if(::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        std::size_t const size = static_cast<std::size_t>(st.st_size);
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED)
+        {
+            data_ = static_cast<char*>(data);
+            size_ = size;
+            ::madvise(data, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+            if(huge_pages)
+                ::madvise(data, size, MADV_HUGEPAGE);
+#endif
+        }
+    }
+    ::close(fd); // the mapping stays valid
+#endif
+    (void)path;
+    (void)huge_pages;
+}
+
+inline mapped_file::~mapped_file()
+{
+#ifdef JBC_JSON_HAS_MMAP
+    if(data_ != nullptr)
+        ::munmap(data_, size_);
+#endif
+}
+
+inline bool mapped_file::is_open() const
+{
+    return data_ != nullptr;
+}
+
+inline char* mapped_file::begin() const
+{
+    return data_;
+}
+
+inline char* mapped_file::end() const
+{
+    return data_ + size_;
+}
+
+inline std::size_t mapped_file::size() const
+{
+    return size_;
+}
+
+}
+}
+
+#endif // JBC_JSON_MAPPED_FILE_H
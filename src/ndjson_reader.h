@@ -0,0 +1,382 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_NDJSON_READER_H
+#define JBC_JSON_NDJSON_READER_H
+
+#include "stl_json.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * The ndjson_reader class parses newline delimited json (one document per line) on a pool of worker threads.
+ *
+ * The input is cut into chunks of whole lines, and each chunk is parsed by a single worker, with a parser owned
+ * by the worker thread and reset between documents. The items are always delivered in the thread that called
+ * parse, either in input order, or in the order the chunks complete when ordering is not required. Only a
+ * bounded number of chunks is in flight at any time, so memory use does not grow with the input size.
+ *
+ * Documents are separated by whitespace, usually a line feed. A document must end on the line where it starts,
+ * since chunks are cut after any line feed : one that spans several lines fails with "Unexpected end of line",
+ * wherever the chunks are cut.
+ */
+class ndjson_reader
+{
+public:
+    /**
+     * @brief callback_type is called for each parsed document. Returning false stops the parsing.
+     */
+    using callback_type = std::function<bool(stl_item&&)>;
+
+    /**
+     * @brief ndjson_reader constructor, starts the worker threads
+     * @param threads number of worker threads, 0 for one per hardware thread
+     * @param chunk_size approximate size in bytes of the chunks given to the workers
+     */
+    explicit ndjson_reader(unsigned int threads = 0, std::size_t chunk_size = 1024 * 1024);
+    ndjson_reader(ndjson_reader const&) = delete;
+    ndjson_reader& operator=(ndjson_reader const&) = delete;
+    ~ndjson_reader();
+
+    /**
+     * @brief set_ordered chooses whether the documents are delivered in input order (the default), or as soon
+     * as their chunk is parsed
+     */
+    void set_ordered(bool ordered);
+
+    /**
+     * @brief parse parses the documents in [begin, end), which must stay valid until parse returns, and calls
+     * callback for each of them.
+     * @return true if every document was parsed and accepted by the callback
+     */
+    bool parse(char* begin, char* end, callback_type const& callback);
+
+    /**
+     * @brief parse_stream reads the documents from the stream, by blocks of chunk_size, and calls callback for
+     * each of them
+     * @return true if every document was parsed and accepted by the callback
+     */
+    template<typename stream>
+    bool parse_stream(stream& f, callback_type const& callback);
+
+    /**
+     * @brief error_message returns the error message of the first document that failed to parse, or nullptr
+     * if there is none (including when the callback stopped the parsing). Do not free this message.
+     */
+    char const* error_message() const;
+
+    /**
+     * @brief error_offset returns the offset in the input of the start of the document that failed to parse
+     */
+    std::size_t error_offset() const;
+
+    /**
+     * @brief thread_count returns the number of worker threads
+     */
+    unsigned int thread_count() const;
+
+private:
+    struct chunk
+    {
+        std::size_t offset = 0; // offset of begin in the whole input
+        std::vector<char> storage; // owned data, when reading from a stream
+        char* begin = nullptr;
+        char* end = nullptr;
+        std::vector<stl_item> items;
+        char const* error = nullptr;
+        std::size_t error_offset = 0;
+        bool done = false;
+    };
+    using chunk_ptr = std::unique_ptr<chunk>;
+
+    void worker_();
+    static void parse_chunk_(stl_parser& parser, chunk& c);
+    template<typename producer>
+    bool run_(producer next_chunk, callback_type const& callback);
+    void submit_(chunk* c);
+    void release_(chunk_ptr c);
+    void wait_all_(std::deque<chunk_ptr> const& in_flight);
+
+    std::size_t chunk_size_;
+    bool ordered_ = true;
+    char const* error_ = nullptr;
+    std::size_t error_offset_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable work_done_;
+    std::deque<chunk*> pending_;
+    std::deque<chunk_ptr> released_; // delivered chunks, destroyed by the workers
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+inline ndjson_reader::ndjson_reader(unsigned int threads, std::size_t chunk_size) :
+    chunk_size_(chunk_size > 0 ? chunk_size : 1)
+{
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    workers_.reserve(threads);
+    for(unsigned int i = 0; i < threads; ++i)
+        workers_.emplace_back(&ndjson_reader::worker_, this);
+}
+
+inline ndjson_reader::~ndjson_reader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+    for(std::thread& t : workers_)
+        t.join();
+}
+
+inline void ndjson_reader::set_ordered(bool ordered)
+{
+    ordered_ = ordered;
+}
+
+inline char const* ndjson_reader::error_message() const
+{
+    return error_;
+}
+
+inline std::size_t ndjson_reader::error_offset() const
+{
+    return error_offset_;
+}
+
+inline unsigned int ndjson_reader::thread_count() const
+{
+    return static_cast<unsigned int>(workers_.size());
+}
+
+inline bool ndjson_reader::parse(char* begin, char* end, callback_type const& callback)
+{
+    char* cur = begin;
+    return run_([this, begin, end, &cur]() -> chunk_ptr {
+        if(cur == end)
+            return nullptr;
+        char* stop = end;
+        if(static_cast<std::size_t>(end - cur) > chunk_size_)
+        {
+            void* nl = std::memchr(cur + chunk_size_, '\n', static_cast<std::size_t>(end - cur) - chunk_size_);
+            if(nl != nullptr)
+                stop = static_cast<char*>(nl) + 1;
+        }
+        chunk_ptr c = std::make_unique<chunk>();
+        c->offset = static_cast<std::size_t>(cur - begin);
+        c->begin = cur;
+        c->end = stop;
+        cur = stop;
+        return c;
+    }, callback);
+}
+
+template<typename stream>
+bool ndjson_reader::parse_stream(stream& f, callback_type const& callback)
+{
+    if(!f.good())
+        return false;
+    std::vector<char> carry; // partial last line of the previous block
+    std::size_t offset = 0;
+    return run_([this, &f, &carry, &offset]() -> chunk_ptr {
+        chunk_ptr c = std::make_unique<chunk>();
+        std::vector<char>& data = c->storage;
+        data.swap(carry);
+        while(f.good())
+        {
+            std::size_t const kept = data.size();
+            data.resize(kept + chunk_size_);
+            std::size_t const got = static_cast<std::size_t>(f.read(data.data() + kept,
+                                                                    static_cast<std::streamsize>(chunk_size_)).gcount());
+            data.resize(kept + got);
+            if(!f.good())
+                break; // end of the stream, the chunk takes everything left
+            auto nl = std::find(data.rbegin(), data.rbegin() + static_cast<std::ptrdiff_t>(got), '\n');
+            if(nl != data.rbegin() + static_cast<std::ptrdiff_t>(got))
+            {
+                carry.assign(nl.base(), data.end());
+                data.erase(nl.base(), data.end());
+                break;
+            }
+        }
+        if(data.empty())
+            return nullptr;
+        c->offset = offset;
+        c->begin = data.data();
+        c->end = data.data() + data.size();
+        offset += data.size();
+        return c;
+    }, callback);
+}
+
+template<typename producer>
+bool ndjson_reader::run_(producer next_chunk, callback_type const& callback)
+{
+    error_ = nullptr;
+    error_offset_ = 0;
+    std::size_t const max_in_flight = 2 * workers_.size() + 1;
+    std::deque<chunk_ptr> in_flight;
+    // the workers may still be using the chunks in flight when leaving, including when the callback or
+    // next_chunk throws
+    struct in_flight_guard
+    {
+        ndjson_reader& reader;
+        std::deque<chunk_ptr>& chunks;
+        ~in_flight_guard() { reader.wait_all_(chunks); }
+    } guard{*this, in_flight};
+    bool input_done = false;
+    bool good = true;
+    while(good)
+    {
+        while(!input_done && in_flight.size() < max_in_flight)
+        {
+            chunk_ptr c = next_chunk();
+            if(!c)
+            {
+                input_done = true;
+                break;
+            }
+            submit_(c.get());
+            in_flight.push_back(std::move(c));
+        }
+        if(in_flight.empty())
+            break;
+        auto ready = in_flight.begin();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_done_.wait(lock, [this, &in_flight, &ready]() {
+                if(ordered_)
+                    return in_flight.front()->done;
+                ready = std::find_if(in_flight.begin(), in_flight.end(), [](chunk_ptr const& c) { return c->done; });
+                return ready != in_flight.end();
+            });
+        }
+        chunk_ptr c = std::move(*ready);
+        in_flight.erase(ready);
+        for(stl_item& item : c->items)
+        {
+            if(!callback(std::move(item)))
+            {
+                good = false;
+                break;
+            }
+        }
+        if(good && c->error != nullptr)
+        {
+            error_ = c->error;
+            error_offset_ = c->error_offset;
+            good = false;
+        }
+        release_(std::move(c));
+    }
+    return good;
+}
+
+inline void ndjson_reader::submit_(chunk* c)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(c);
+    }
+    work_available_.notify_one();
+}
+
+inline void ndjson_reader::release_(chunk_ptr c)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        released_.push_back(std::move(c));
+    }
+    work_available_.notify_one();
+}
+
+inline void ndjson_reader::wait_all_(std::deque<chunk_ptr> const& in_flight)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_done_.wait(lock, [&in_flight]() {
+        return std::all_of(in_flight.begin(), in_flight.end(), [](chunk_ptr const& c) { return c->done; });
+    });
+}
+
+inline void ndjson_reader::worker_()
+{
+    stl_parser parser;
+    for(;;)
+    {
+        chunk* c = nullptr;
+        chunk_ptr released;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_available_.wait(lock, [this]() { return stopping_ || !pending_.empty() || !released_.empty(); });
+            if(!pending_.empty())
+            {
+                c = pending_.front();
+                pending_.pop_front();
+            }
+            else if(!released_.empty())
+            {
+                released = std::move(released_.front());
+                released_.pop_front();
+            }
+            else
+                return;
+        }
+        if(c != nullptr)
+        {
+            parse_chunk_(parser, *c);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                c->done = true;
+            }
+            work_done_.notify_all();
+        }
+        // a released chunk is destroyed here, out of the lock and out of the delivering thread
+    }
+}
+
+inline void ndjson_reader::parse_chunk_(stl_parser& parser, chunk& c)
+{
+    char* cur = c.begin;
+    for(;;)
+    {
+        cur = scan_helper<char>::skip_whitespace(cur, c.end);
+        if(cur == c.end)
+            return;
+        void* nl = std::memchr(cur, '\n', static_cast<std::size_t>(c.end - cur));
+        char* line_end = nl != nullptr ? static_cast<char*>(nl) + 1 : c.end; // the document must end on this line
+        auto res = parser.consume_document(cur, line_end);
+        if(!res.first || !parser.complete_without_error())
+        {
+            c.error = parser.error_message() != nullptr ? parser.error_message() : "Unexpected end of line";
+            c.error_offset = c.offset + static_cast<std::size_t>(cur - c.begin);
+            parser.reset();
+            return;
+        }
+        c.items.emplace_back();
+        parser.moveTo(c.items.back());
+        parser.reset();
+        cur += res.second;
+    }
+}
+
+}
+}
+
+#endif // JBC_JSON_NDJSON_READER_H
@@ -13,6 +13,8 @@
 
 #include <array>
 #include <cassert>
+#include <charconv>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 
@@ -109,6 +111,15 @@ public:
     template<typename buffer>
     static bool number(double number, int precision, locator& loc, buffer& buf, int& offset);
 
+    /**
+     * Outputs a single integer into the buffer. If it does not fit into buffer, will output what it can, and
+     * set the locator accordingly.
+     * @return true if written completely, false otherwise
+     * @remark When returning true, the locator is reset.
+     */
+    template<typename buffer>
+    static bool integer(std::int64_t value, locator& loc, buffer& buf, int& offset);
+
     /**
      * Outputs a single boolean into the buffer. If it does not fit into buffer, will output what it can, and
      * set the locator accordingly.
@@ -213,6 +224,13 @@ public:
         return output<char_type, locator>::number(value, 10, loc_, buf_, offset_);
     }
 
+#ifdef JSON_USE_LONG_INTEGERS
+    bool operator()(std::int64_t value)
+    {
+        return output<char_type, locator>::integer(value, loc_, buf_, offset_);
+    }
+#endif
+
     bool operator()(typename item::traits::string_type const& value)
     {
         return output<char_type, locator>::template string<typename item::traits>(value, loc_, buf_, offset_);
@@ -295,6 +313,29 @@ bool output<char_type, locator>::number(double number, int precision, locator& l
     return true;
 }
 
+template<typename char_type, typename locator>
+template<typename buffer>
+bool output<char_type, locator>::integer(std::int64_t value, locator& loc, buffer& buf, int& offset)
+{
+    std::array<char, 20> chars; // enough for -9223372036854775808
+    size_t data_size = static_cast<size_t>(std::to_chars(chars.data(), chars.data() + chars.size(), value).ptr - chars.data());
+    using namespace std;
+    auto buf_size = buf.size();
+    int writtensize = std::min(data_size - loc.position, buf_size - offset);
+    std::copy(chars.data() + loc.position,
+              chars.data() + loc.position + writtensize,
+              buf.data() + offset);
+    if(data_size - loc.position > buf_size - offset)
+    {
+        offset += writtensize;
+        loc.position += writtensize;
+        return false;
+    }
+    offset += writtensize;
+    loc.reset();
+    return true;
+}
+
 template<typename char_type, typename locator>
 template<typename buffer>
 bool output<char_type, locator>::boolean(bool value, locator& loc, buffer& buf, int& offset)
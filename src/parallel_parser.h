@@ -0,0 +1,170 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_PARALLEL_PARSER_H
+#define JBC_JSON_PARALLEL_PARSER_H
+
+#include "stl_json.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace jbc
+{
+namespace json
+{
+
+namespace parallel_parser_detail
+{
+
+/**
+ * @brief count_quotes returns the number of double quotes in [begin, end) that are not escaped by a backslash.
+ * begin must not be preceded by a backslash.
+ */
+inline std::size_t count_quotes(char const* begin, char const* end)
+{
+    std::size_t count = 0;
+    char const* cur = begin;
+    while(cur != end)
+    {
+        void const* quote = std::memchr(cur, '"', static_cast<std::size_t>(end - cur));
+        if(quote == nullptr)
+            break;
+        char const* q = static_cast<char const*>(quote);
+        char const* b = q;
+        while(b != begin && *(b - 1) == '\\')
+            --b;
+        if((q - b) % 2 == 0)
+            ++count;
+        cur = q + 1;
+    }
+    return count;
+}
+
+/**
+ * @brief guess_split returns the first comma in [begin, end) that is followed by an object or an array, which
+ * is where a record most probably starts. It may be inside a string or a nested value : this must be verified.
+ * @return end if there is none
+ */
+inline char* guess_split(char* begin, char* end)
+{
+    for(char* cur = begin; cur != end; ++cur)
+    {
+        cur = static_cast<char*>(std::memchr(cur, ',', static_cast<std::size_t>(end - cur)));
+        if(cur == nullptr)
+            return end;
+        char* next = scan_helper<char>::skip_whitespace(cur + 1, end);
+        if(next != end && (*next == '{' || *next == '['))
+            return cur;
+    }
+    return end;
+}
+
+/**
+ * @brief The slice struct is a part of the content of the top level array, parsed by its own thread
+ */
+struct slice
+{
+    slice(char* b, char* e) : begin(b), end(e) {}
+    char* begin;
+    char* end;
+    std::size_t quotes = 0;
+    bool good = false;
+    stl_item items;
+};
+
+/**
+ * @brief parse_slice parses the values of a slice in place, as the elements of an array. It uses the structural
+ * parser, as the serial fallback (parse_from_buffer) does, so that both accept the same documents.
+ */
+inline void parse_slice(slice& s)
+{
+    s.quotes = count_quotes(s.begin, s.end);
+    if(scan_helper<char>::skip_whitespace(s.begin, s.end) == s.end)
+        return; // would hide a misplaced comma
+    stl_structural_parser parser;
+    s.good = parser.parse_list(s.begin, s.end);
+    if(s.good)
+        parser.moveTo(s.items);
+}
+
+}
+
+/**
+ * @brief parse_parallel parses a document entirely in memory whose top level value is an array, using several
+ * threads. The buffer is split at guessed boundaries between array elements, and each slice is parsed on its own
+ * thread. The guesses are then verified : every split must be outside of any string (even number of unescaped
+ * quotes before it), and every slice must be a valid list of values, which proves the split was made at the top
+ * level. Elements are then moved into destination. If any check fails, or if the document is not a large
+ * enough array, the document is parsed by the serial parser instead, see parse_from_buffer.
+ * @param threads number of threads, 0 for one per hardware thread
+ * @param min_slice_size minimum size in bytes of the slice given to a thread
+ */
+inline bool parse_parallel(char* begin, char* end, stl_item& destination, unsigned int threads = 0,
+                           std::size_t min_slice_size = 1024 * 1024)
+{
+    using namespace parallel_parser_detail;
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    char* first = scan_helper<char>::skip_whitespace(begin, end);
+    char* last = end;
+    while(last != first && token_helper<char>::is_token_space(*(last - 1)))
+        --last;
+    std::size_t const size = static_cast<std::size_t>(last - first);
+    if(size < 2 || *first != '[' || *(last - 1) != ']')
+        return parse_from_buffer(begin, end, destination);
+    threads = static_cast<unsigned int>(std::min<std::size_t>(threads, size / std::max<std::size_t>(min_slice_size, 1)));
+    if(threads <= 1)
+        return parse_from_buffer(begin, end, destination);
+
+    char* content = first + 1;
+    char* content_end = last - 1;
+    std::size_t const content_size = static_cast<std::size_t>(content_end - content);
+    std::vector<slice> slices;
+    char* slice_begin = content;
+    for(unsigned int i = 1; i < threads; ++i)
+    {
+        char* target = std::max(slice_begin, content + content_size / threads * i);
+        char* split = guess_split(target, content_end);
+        if(split == content_end)
+            break;
+        slices.emplace_back(slice_begin, split);
+        slice_begin = split + 1;
+    }
+    slices.emplace_back(slice_begin, content_end);
+    if(slices.size() == 1)
+        return parse_from_buffer(begin, end, destination);
+
+    std::vector<std::thread> workers;
+    workers.reserve(slices.size() - 1);
+    for(std::size_t i = 1; i < slices.size(); ++i)
+        workers.emplace_back(parse_slice, std::ref(slices[i]));
+    parse_slice(slices[0]);
+    for(std::thread& t : workers)
+        t.join();
+
+    std::size_t quotes = 0;
+    for(slice const& s : slices)
+    {
+        quotes += s.quotes;
+        if(!s.good || quotes % 2 != 0)
+            return parse_from_buffer(begin, end, destination);
+    }
+    stl_item result(ItemType::Array);
+    for(slice& s : slices)
+    {
+        for(auto it = s.items.begin_array(); it != s.items.end_array(); ++it)
+            result.add_item(std::move(*it));
+        s.items = stl_item();
+    }
+    destination = std::move(result);
+    return true;
+}
+
+}
+}
+
+#endif // JBC_JSON_PARALLEL_PARSER_H
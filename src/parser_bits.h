@@ -7,8 +7,17 @@
 #define JBC_JSON_PARSER_BITS_H
 
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include "handler_result.h"
 #include "helper_functions.h"
+#include "parser_limits.h"
+#include "text_position.h"
+#include "scan_helpers.h"
+#include "utf8_validator.h"
 
 namespace jbc
 {
@@ -25,14 +34,76 @@ template<template<class> class container,
 class parser_bits :
     public parser_callbacks
 {
+public:
+    /**
+     * @brief no_error_offset is the error offset when there is no error
+     */
+    static constexpr std::size_t no_error_offset = static_cast<std::size_t>(-1);
 
-    using consumer_fn = bool(parser_bits::*)(char_type_*);
+protected:
+    /**
+     * @brief The State enum lists the states of the parser. Structural states (between tokens) come first,
+     * so that they can be tested with a single comparison.
+     */
+    enum class State : std::uint8_t
+    {
+        Initial,
+        ArrayStart,
+        ArraySeparator,
+        ObjectSeparator,
+        Array,
+        ObjectStart,
+        ObjectBetween,
+        ObjectKey,
+        ObjectValue,
+        FalseF,
+        FalseA,
+        FalseL,
+        FalseS,
+        TrueT,
+        TrueR,
+        TrueU,
+        NullN,
+        NullU,
+        NullL,
+        StringKey,
+        String,
+        StringEscape,
+        StringUValue,
+        StringUValue1,
+        StringUValue2,
+        StringUValue3,
+        StringUValue4,
+        StringUValue5,
+        StringUValue6,
+        StringUValue7,
+        StringUValue8,
+        StringUValue9,
+        NumberStarting0,
+        Number,
+        SkipValue,
+        Skip,
+        InError
+    };
 
-    container<consumer_fn> consumer_stack_;
+    /**
+     * @brief state_ is the current state. The enclosing states are stored in state_stack_, the
+     * bottom of the stack being the Initial state.
+     */
+    State state_ = State::Initial;
+    container<State> state_stack_;
 
     uint32_t lastCodePoint = 0;
 #ifdef JSON_USE_LONG_INTEGERS
     bool lastNumIsFloat = false;
+    bool lastNumNegative_ = false;
+    /**
+     * @brief lastNumDigits_ and lastInteger_ accumulate the digits of an integer as they are read. Integers
+     * of at most max_accumulated_digits digits cannot overflow, and never go through a conversion function
+     */
+    unsigned int lastNumDigits_ = 0;
+    std::uint64_t lastInteger_ = 0;
+    static constexpr unsigned int max_accumulated_digits = 18;
 #endif
     bool end_ = false;
     bool error_ = false;
@@ -40,19 +111,142 @@ class parser_bits :
     bool inside_key_ = false; // need to be stored, because we use the same functions for string and key handling of special characters
     char const* err_ = nullptr;
     /**
-     * @brief lastValue_ stores the last value. Is currently still needed only for number parsing
+     * @brief lastValue_ stores the last value. Used for decoded unicode escapes, and for numbers that span
+     * several buffers
      */
     buffer_type_ lastValue_;
     /**
-     * @brief first_ stores the first char of the data currently being processed. Used for strings
-     * and keys
+     * @brief first_ stores the first char of the data currently being processed. Used for strings,
+     * keys and numbers
      */
     char_type_* first_ = nullptr;
     char_type_* end_buf_ = nullptr;
+    /**
+     * @brief in_situ_ tells whether escape sequences are decoded in place, inside the input buffer
+     */
+    bool in_situ_ = false;
+    /**
+     * @brief limits_ are the limits set by the user. The max_*_ members are the effective limits, where no limit is
+     * the largest value, so that each check is a single comparison
+     */
+    parser_limits limits_;
+    std::size_t max_depth_ = parser_limits::effective(0);
+    std::size_t max_string_length_ = parser_limits::effective(0);
+    std::size_t max_number_length_ = parser_limits::effective(0);
+    std::size_t max_element_count_ = parser_limits::effective(0);
+    std::size_t string_length_ = 0; // length of the current string or key
+    std::size_t element_count_ = 0;
+    parse_error error_code_ = parse_error::none;
+    /**
+     * @brief consumed_ counts the characters given to the previous consume calls. It is only updated once per
+     * buffer, the offset of an error inside a buffer being computed when it happens
+     */
+    std::size_t consumed_ = 0;
+    std::size_t error_offset_ = no_error_offset;
+    /**
+     * @brief validate_utf8_ enables the validation of strings and keys by utf8_
+     */
+    bool validate_utf8_ = false;
+    utf8_validator utf8_;
+    /**
+     * @brief skip_depth_ is the number of brackets left to close in the value being skipped, 0 for a string, a
+     * number or a literal. skip_next_value_ is set when the value of the current key must be skipped
+     */
+    std::size_t skip_depth_ = 0;
+    bool skip_in_string_ = false;
+    bool skip_escape_ = false;
+    bool skip_next_value_ = false;
+
+    /**
+     * @brief note_error_offset_ records the offset of the first error, position being relative to the current buffer
+     */
+    void note_error_offset_(std::size_t position)
+    {
+        if(error_offset_ == no_error_offset)
+            error_offset_ = consumed_ + position;
+    }
 
     void pop_state();
 
-    bool make_error(char const* message);
+    void push_state_(State state)
+    {
+        state_stack_.push_back(state_);
+        state_ = state;
+    }
+
+    /**
+     * @brief utf8_char_ validates a plain string character that goes through the state machine
+     */
+    bool utf8_char_(char_type_ c)
+    {
+        if constexpr(sizeof(char_type_) == 1 && std::is_integral_v<char_type_>)
+            return !validate_utf8_ || utf8_.validate(static_cast<unsigned char>(c));
+        else
+            return true;
+    }
+    /**
+     * @brief utf8_complete_ tells whether the string does not end in the middle of a multibyte character
+     */
+    bool utf8_complete_() const
+    {
+        return !validate_utf8_ || utf8_.complete();
+    }
+
+    /**
+     * @brief start_skip_ starts skipping a value, in place of the current state
+     */
+    void start_skip_(std::size_t depth, bool in_string)
+    {
+        skip_depth_ = depth;
+        skip_in_string_ = in_string;
+        skip_escape_ = false;
+        state_ = State::Skip;
+    }
+    /**
+     * @brief container_started_ handles the result of a begin_array or begin_object handler, called once the
+     * container state is pushed. Skipping the container replaces that state.
+     */
+    bool container_started_(handler_result result, char const* message)
+    {
+        if(result == handler_result::skip)
+        {
+            start_skip_(1, false);
+            return true;
+        }
+        return result == handler_result::proceed || handler_error_(message);
+    }
+
+    void start_string_(State state)
+    {
+        string_length_ = 0;
+        push_state_(state);
+    }
+
+    /**
+     * @brief push_container_ enters an array or an object, if the maximum depth allows it
+     */
+    bool push_container_(State state);
+    /**
+     * @brief count_element_ counts a new value, and checks the maximum element count
+     */
+    bool count_element_();
+    /**
+     * @brief string_content_ and key_content_ check the string length, and forward the content to the handlers
+     */
+    template<typename view_type>
+    bool string_content_(view_type value);
+    template<typename view_type>
+    bool key_content_(view_type value);
+
+    /**
+     * @brief make_error puts the parser in error. Only the first error is kept.
+     */
+    bool make_error(char const* message, parse_error code = parse_error::syntax);
+    /**
+     * @brief handler_error_ puts the parser in error after a handler failed. If the callbacks enforce limits,
+     * the limit they reached is reported as the error code
+     */
+    bool handler_error_(char const* message);
 
     bool consume_initial_(char_type_* c);
     bool consume_arraystart_(char_type_* c);
@@ -88,22 +282,96 @@ class parser_bits :
     bool consume_stringuvalue9_(char_type_* c);
     bool consume_numberstarting0_(char_type_* c);
     bool consume_number_(char_type_* c);
+    bool consume_skipvalue_(char_type_* c);
+    bool consume_skip_(char_type_* c);
     bool consume_inerror_(char_type_*);
 public:
+    /**
+     * @brief consume_ dispatches the character to the handler of the current state. A null pointer
+     * tells the current state that the buffer ends, so that pending data is reported.
+     * @return true if parser did not make any error, false otherwise
+     */
     bool consume_(char_type_* c);
-private:
-    void push_consumer_(consumer_fn fn)
-    {
-        consumer_stack_.push_back(fn);
-    }
+protected:
+    /**
+     * @brief dispatch_ is the state machine switch itself. It is forcibly inlined so that the loop
+     * in consume(begin, end) does not go through a function call for every character.
+     */
+    JBC_JSON_ALWAYS_INLINE bool dispatch_(char_type_* c);
     /** Internals, used for factorization purpose */
    bool consume_array_itembegin_(char_type_* char_);
+    /**
+     * @brief scan_string_run_ skips over the plain characters of a string or key, starting at begin.
+     * The whole run is accumulated in first_ / end_buf_, so that a single view is reported for it. When enabled,
+     * UTF-8 validation is done on the run, while it is still in cache.
+     * @param good set to false if the run is not valid UTF-8
+     * @return pointer to the first character that must go through the state machine, or after the invalid one
+     */
+    char_type_* scan_string_run_(char_type_* begin, char_type_* end, bool& good);
+    /**
+     * @brief in_structural_state_ tells whether the current state is between tokens, where
+     * whitespace is insignificant and can be skipped without going through the state machine
+     */
+    bool in_structural_state_() const;
+    /**
+     * @brief in_value_start_state_ tells whether the current state expects an array item or an object value
+     */
+    bool in_value_start_state_() const;
+    /**
+     * @brief match_literal_ validates a whole true, false or null literal starting at begin with a single
+     * comparison, and reports it. Only used with single byte characters, when the literal is entirely
+     * inside [begin, end) : literals split across buffers go through the per letter states.
+     * @param good set to the result of the handler when a literal is matched
+     * @return pointer after the literal, or begin if no literal was matched
+     */
+    char_type_* match_literal_(char_type_* begin, char_type_* end, bool& good);
+    /**
+     * @brief decode_escapes_ decodes the run of consecutive escape sequences starting at begin, which must be a
+     * backslash inside a string or key. Unicode escapes, including surrogate pairs, are decoded in one step. The
+     * whole run is reported with a single handler call. An escape sequence that is split across buffers, or
+     * invalid, stops the run : it goes through the escape states instead. In situ, the decoded run is
+     * written in place and appended to the pending view, without calling any handler.
+     * @param good set to the result of the handlers when at least one escape is decoded
+     * @return pointer after the decoded run, or begin if nothing was decoded
+     */
+    char_type_* decode_escapes_(char_type_* begin, char_type_* end, bool& good);
+    /**
+     * @brief skip_run_ fast forwards over the value being skipped, from begin, jumping directly to the next quote
+     * or bracket. When the value ends, the enclosing state is restored.
+     * @return pointer after the value, or end if it goes on in the next buffer
+     */
+    char_type_* skip_run_(char_type_* begin, char_type_* end);
+    /**
+     * @brief start_number_ records the first character of a number. Digits stay in the input buffer,
+     * and are only copied to lastValue_ when the number spans several buffers
+     */
+    void start_number_(char_type_* char_);
+    /**
+     * @brief extend_number_ adds a character to the number being read
+     */
+    void extend_number_(char_type_* char_);
+    /**
+     * @brief flush_number_ copies the digits read from the current buffer to lastValue_, before the buffer
+     * goes away
+     */
+    void flush_number_();
+    /**
+     * @brief end_number_ converts the number that has just been read, and reconsumes char_, which is not
+     * part of the number
+     */
+    bool end_number_(char_type_* char_);
+    /**
+     * @brief consume_run_ is the bulk parsing loop shared by consume and consume_document. It does not flush
+     * pending data at the end of the buffer.
+     * @return position where parsing stopped : end, the character after the end of the document if
+     * stop_at_document_end is set, or the character after an error
+     */
+    template<bool stop_at_document_end, typename char_type_iterator>
+    char_type_iterator consume_run_(char_type_iterator begin, char_type_iterator end, bool& good);
 public:
     using buffer_type = buffer_type_;
     using char_type = char_type_;
-    parser_bits() {
-        consumer_stack_.push_back(&parser_bits::consume_initial_);
-    }
+    parser_bits() = default;
 
     /**
      * @brief consume reads one character and parses it accordingly
@@ -121,6 +389,37 @@ public:
     template<typename char_type_iterator>
     bool consume(char_type_iterator begin, char_type_iterator end);
 
+    /**
+     * @brief consume_document reads characters until the end of the current top level value, and stops right
+     * after it. Used to parse concatenated documents from the same buffer : call reset() and consume_document
+     * again with the remaining characters to parse the next one.
+     * @param begin start of array
+     * @param end end of array
+     * @return first : true if parser did not make any error, false otherwise (including when called again on
+     * a completed document). second : number of characters consumed. If the document is not complete yet,
+     * all characters are consumed, and parsing can go on with the next buffer.
+     */
+    template<typename char_type_iterator>
+    std::pair<bool, std::size_t> consume_document(char_type_iterator begin, char_type_iterator end);
+
+    /**
+     * @brief reset puts the parser back in its initial state, so that it can parse another document. Stacks
+     * and buffers keep their capacity. The callbacks are reset too, if they provide a reset() member.
+     */
+    void reset();
+
+    /**
+     * @brief set_in_situ enables or disables in situ parsing. In situ, escape sequences are decoded in place,
+     * inside the buffer given to consume(begin, end), which is modified. Every string and key that lies
+     * entirely inside one buffer is then reported as a single view into that buffer. Strings split across
+     * buffers are still reported in several parts.
+     */
+    void set_in_situ(bool in_situ);
+    /**
+     * @brief in_situ tells whether in situ parsing is enabled
+     */
+    bool in_situ() const;
+
     /**
      * @brief end Ends the current parser. Can be called when reading from an entire stream. Will indicate if parsing
      * was incomplete.
@@ -141,14 +440,55 @@ public:
      */
     char const* error_message() const;
 
+    /**
+     * @brief error_code tells why parsing failed
+     * @return parse_error::none if there was no error
+     */
+    parse_error error_code() const;
+
+    /**
+     * @brief error_offset returns the offset, from the start of the document, of the character at which the
+     * first error was detected. Only the consume and consume_document functions track offsets.
+     * @return no_error_offset if there was no error
+     */
+    std::size_t error_offset() const;
+
+    /**
+     * @brief error_position returns the line and column of the first error. They are computed from the document
+     * [begin, end), which must be the whole document given to the parser.
+     */
+    text_position error_position(char_type_ const* begin, char_type_ const* end) const;
+
+    /**
+     * @brief set_limits sets the resource limits checked while parsing. They are forwarded to the callbacks, if
+     * they provide set_limits. Should be called before parsing starts.
+     */
+    void set_limits(parser_limits const& limits);
+    /**
+     * @brief limits returns the resource limits
+     */
+    parser_limits const& limits() const;
+
+    /**
+     * @brief set_utf8_validation enables or disables the validation of the UTF-8 encoding of strings and keys,
+     * including multibyte characters split across buffers. Disabled by default, only available with single byte
+     * characters. Invalid documents fail with parse_error::invalid_utf8.
+     */
+    void set_utf8_validation(bool validate);
+    /**
+     * @brief utf8_validation tells whether UTF-8 validation is enabled
+     */
+    bool utf8_validation() const;
+
 };
 
 template<template<class> class container,
 typename parser_callbacks,typename buffer_type_, typename char_type_>
 void parser_bits<container,parser_callbacks, buffer_type_, char_type_>::pop_state()
 {
-      consumer_stack_.pop_back();
-      if(consumer_stack_.size() == 1) // only the initial consumer is left
+      state_ = state_stack_.back();
+      state_stack_.pop_back();
+      if(state_stack_.empty()) // only the initial state is left
         end_ = true;
 }
 
@@ -163,18 +503,20 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         if(!begin_)
             return make_error("Extra data (object) after document");
         begin_ = false;
-        push_consumer_(&parser_bits::consume_objectstart_);
-        return parser_callbacks::begin_object_handler() ||
-            make_error("begin_object_handler_begin failed");
+        if(!push_container_(State::ObjectStart))
+            return false;
+        return container_started_(to_handler_result(parser_callbacks::begin_object_handler()),
+                                  "begin_object_handler_begin failed");
     }
     if(token_helper<char_type_>::is_token_opening_square_bracket(*char_))
     {
         if(!begin_)
             return make_error("Extra data (array) after document");
         begin_ = false;
-        push_consumer_(&parser_bits::consume_arraystart_);
-        return parser_callbacks::begin_array_handler() ||
-            make_error("begin_array_handler_begin failed");
+        if(!push_container_(State::ArrayStart))
+            return false;
+        return container_started_(to_handler_result(parser_callbacks::begin_array_handler()),
+                                  "begin_array_handler_begin failed");
     }
     if(token_helper<char_type_>::is_token_double_quote(*char_))
     {
@@ -183,11 +525,9 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
             return make_error("Extra data (string) after document");
         }
         begin_ = false;
-        first_ = char_ + 1;
-        end_buf_ = char_ + 1;
-        push_consumer_(&parser_bits::consume_string_);
+        start_string_(State::String);
         return parser_callbacks::begin_string_handler() ||
-                make_error("begin_string_handler_begin failed");
+                handler_error_("begin_string_handler_begin failed");
     }
     if(token_helper<char_type_>::is_token_space(*char_))
         return true;
@@ -200,58 +540,53 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
 {
     if(char_ == nullptr)
         return !error_;
+    if(!count_element_())
+        return false;
     if(token_helper<char_type_>::is_token_double_quote(*char_))
     {
-        push_consumer_(&parser_bits::consume_string_);
-        return parser_callbacks::begin_string_handler();
+        start_string_(State::String);
+        return parser_callbacks::begin_string_handler() || handler_error_("begin_string_handler failed");
     }
     if(token_helper<char_type_>::is_token_opening_curly_bracket(*char_))
     {
-        push_consumer_(&parser_bits::consume_objectstart_);
-        return parser_callbacks::begin_object_handler() ||
-                make_error("begin_object_handler_array Failed");
+        if(!push_container_(State::ObjectStart))
+            return false;
+        return container_started_(to_handler_result(parser_callbacks::begin_object_handler()),
+                                  "begin_object_handler_array Failed");
     }
     if(token_helper<char_type_>::is_token_opening_square_bracket(*char_))
     {
-        push_consumer_(&parser_bits::consume_arraystart_);
-        return parser_callbacks::begin_array_handler() ||
-            make_error("begin_array_handler_array Failed");
-        return true;
+        if(!push_container_(State::ArrayStart))
+            return false;
+        return container_started_(to_handler_result(parser_callbacks::begin_array_handler()),
+                                  "begin_array_handler_array Failed");
     }
     if(token_helper<char_type_>::is_token_minussign(*char_) ||
             token_helper<char_type_>::is_token_digit19(*char_))
     {
-        helper_functions<buffer_type_, char_type_>::truncate(lastValue_);
-        helper_functions<buffer_type_, char_type_>::append(lastValue_, *char_);
-#ifdef JSON_USE_LONG_INTEGERS
-        lastNumIsFloat = false;
-#endif
-        push_consumer_(&parser_bits::consume_number_);
+        start_number_(char_);
+        push_state_(State::Number);
         return true;
     }
     if(token_helper<char_type_>::is_token_zero(*char_))
     {
-        helper_functions<buffer_type_, char_type_>::truncate(lastValue_);
-        helper_functions<buffer_type_, char_type_>::append(lastValue_, *char_);
-#ifdef JSON_USE_LONG_INTEGERS
-        lastNumIsFloat = false;
-#endif
-        push_consumer_(&parser_bits::consume_numberstarting0_);
+        start_number_(char_);
+        push_state_(State::NumberStarting0);
         return true;
     }
     if(token_helper<char_type_>::is_token_char_n(*char_))
     {
-        push_consumer_(&parser_bits::consume_nulln_);
+        push_state_(State::NullN);
         return true;
     }
     if(token_helper<char_type_>::is_token_char_t(*char_))
     {
-        push_consumer_(&parser_bits::consume_truet_);
+        push_state_(State::TrueT);
         return true;
     }
     if(token_helper<char_type_>::is_token_char_f(*char_))
     {
-        push_consumer_(&parser_bits::consume_falsef_);
+        push_state_(State::FalseF);
         return true;
     }
     return false;
@@ -269,9 +604,9 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(token_helper<char_type_>::is_token_closing_square_bracket(*char_))
     {
         pop_state();
-        return parser_callbacks::end_array_handler() || make_error("end_array_handler failed");
+        return parser_callbacks::end_array_handler() || handler_error_("end_array_handler failed");
     }
-    consumer_stack_.back() = &parser_bits::consume_array_; // in every other case, consider now to be inside the array
+    state_ = State::Array; // in every other case, consider now to be inside the array
     if(!consume_array_itembegin_(char_))
     {
         if(!err_)
@@ -288,7 +623,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return !error_;
     if(token_helper<char_type_>::is_token_space(*char_))
         return true;
-    consumer_stack_.back() = &parser_bits::consume_array_;
+    state_ = State::Array;
     if(!consume_array_itembegin_(char_))
     {
         if(!err_)
@@ -305,60 +640,54 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return !error_;
     if(token_helper<char_type_>::is_token_space(*char_))
         return true;
-    consumer_stack_.back() = &parser_bits::consume_objectvalue_;
+    if(!count_element_())
+        return false;
+    state_ = State::ObjectValue;
     if(token_helper<char_type_>::is_token_double_quote(*char_))
     {
-        push_consumer_(&parser_bits::consume_string_);
-        return parser_callbacks::begin_string_handler();
+        start_string_(State::String);
+        return parser_callbacks::begin_string_handler() || handler_error_("begin_string_handler failed");
     }
     if(token_helper<char_type_>::is_token_opening_curly_bracket(*char_))
     {
-        push_consumer_(&parser_bits::consume_objectstart_);
-        return parser_callbacks::begin_object_handler() ||
-            make_error("begin_object_handler_object_value failed");
-        return true;
+        if(!push_container_(State::ObjectStart))
+            return false;
+        return container_started_(to_handler_result(parser_callbacks::begin_object_handler()),
+                                  "begin_object_handler_object_value failed");
     }
     if(token_helper<char_type_>::is_token_opening_square_bracket(*char_))
     {
-        push_consumer_(&parser_bits::consume_arraystart_);
-        return parser_callbacks::begin_array_handler() ||
-            make_error("begin_array_handler_object_value failed");
-        return true;
+        if(!push_container_(State::ArrayStart))
+            return false;
+        return container_started_(to_handler_result(parser_callbacks::begin_array_handler()),
+                                  "begin_array_handler_object_value failed");
     }
     if(token_helper<char_type_>::is_token_minussign(*char_) ||
             token_helper<char_type_>::is_token_digit19(*char_))
     {
-        helper_functions<buffer_type_, char_type_>::truncate(lastValue_);
-        helper_functions<buffer_type_, char_type_>::append(lastValue_, *char_);
-#ifdef JSON_USE_LONG_INTEGERS
-        lastNumIsFloat = false;
-#endif
-        push_consumer_(&parser_bits::consume_number_);
+        start_number_(char_);
+        push_state_(State::Number);
         return true;
     }
     if(token_helper<char_type_>::is_token_zero(*char_))
     {
-        helper_functions<buffer_type_, char_type_>::truncate(lastValue_);
-        helper_functions<buffer_type_, char_type_>::append(lastValue_, *char_);
-#ifdef JSON_USE_LONG_INTEGERS
-        lastNumIsFloat = false;
-#endif
-        push_consumer_(&parser_bits::consume_numberstarting0_);
+        start_number_(char_);
+        push_state_(State::NumberStarting0);
         return true;
     }
     if(token_helper<char_type_>::is_token_char_n(*char_))
     {
-        push_consumer_(&parser_bits::consume_nulln_);
+        push_state_(State::NullN);
         return true;
     }
     if(token_helper<char_type_>::is_token_char_t(*char_))
     {
-        push_consumer_(&parser_bits::consume_truet_);
+        push_state_(State::TrueT);
         return true;
     }
     if(token_helper<char_type_>::is_token_char_f(*char_))
     {
-        push_consumer_(&parser_bits::consume_falsef_);
+        push_state_(State::FalseF);
         return true;
     }
     return make_error("Unexpected token in ObjectSeparator");
@@ -375,11 +704,11 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(token_helper<char_type_>::is_token_closing_square_bracket(*char_))
     {
         pop_state();
-        return parser_callbacks::end_array_handler() || make_error("end array handler failed");
+        return parser_callbacks::end_array_handler() || handler_error_("end array handler failed");
     }
     if(token_helper<char_type_>::is_token_comma(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_arrayseparator_;
+        state_ = State::ArraySeparator;
         return true;
     }
     return make_error("Unexpected token in Array");
@@ -396,13 +725,13 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(token_helper<char_type_>::is_token_closing_curly_bracket(*char_))
     {
         pop_state();
-        return parser_callbacks::end_object_handler() || make_error("end_object_handler failed");
+        return parser_callbacks::end_object_handler() || handler_error_("end_object_handler failed");
     }
-    consumer_stack_.back() = &parser_bits::consume_objectkey_;
+    state_ = State::ObjectKey;
     if(token_helper<char_type_>::is_token_double_quote(*char_))
     {
-        push_consumer_(&parser_bits::consume_stringkey_);
-        return parser_callbacks::begin_key_handler();
+        start_string_(State::StringKey);
+        return parser_callbacks::begin_key_handler() || handler_error_("begin_key_handler failed");
     }
     return make_error("Unexpected token in ObjectStart");
 }
@@ -417,9 +746,9 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return true;
     if(token_helper<char_type_>::is_token_double_quote(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_objectkey_;
-        push_consumer_(&parser_bits::consume_stringkey_);
-        return parser_callbacks::begin_key_handler();
+        state_ = State::ObjectKey;
+        start_string_(State::StringKey);
+        return parser_callbacks::begin_key_handler() || handler_error_("begin_key_handler failed");
     }
     return make_error("Unexpected token in ObjectBetween");
 }
@@ -434,7 +763,14 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return true;
     if(token_helper<char_type_>::is_token_colon(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_objectseparator_;
+        if(skip_next_value_)
+        {
+            skip_next_value_ = false;
+            state_ = State::ObjectValue;
+            push_state_(State::SkipValue);
+        }
+        else
+            state_ = State::ObjectSeparator;
         return true;
     }
     return make_error("Unexpected token in ObjectKey");
@@ -452,12 +788,12 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     {
         pop_state();
         return parser_callbacks::end_object_handler() ||
-            make_error("end_object_handler failed");
+            handler_error_("end_object_handler failed");
         return true;
     }
     if(token_helper<char_type_>::is_token_comma(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_objectbetween_;
+        state_ = State::ObjectBetween;
         return true;
     }
     return make_error("Unexpected token in ObjectValue");
@@ -471,7 +807,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return !error_;
     if(token_helper<char_type_>::is_token_char_a(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_falsea_;
+        state_ = State::FalseA;
         return true;
     }
     return make_error("Unexpected token in False_F");
@@ -485,7 +821,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return true;
     if(token_helper<char_type_>::is_token_char_l(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_falsel_;
+        state_ = State::FalseL;
         return true;
     }
     return make_error("Unexpected token in False_A");
@@ -499,7 +835,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return true;
     if(token_helper<char_type_>::is_token_char_s(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_falses_;
+        state_ = State::FalseS;
         return true;
     }
     return make_error("Unexpected token in False_L");
@@ -514,7 +850,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(token_helper<char_type_>::is_token_char_e(*char_))
     {
         pop_state();
-        return parser_callbacks::boolean_handler(false) || make_error("boolean_handler failed");
+        return parser_callbacks::boolean_handler(false) || handler_error_("boolean_handler failed");
     }
     return make_error("Unexpected token in False_S");
 }
@@ -527,7 +863,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return true;
     if(token_helper<char_type_>::is_token_char_r(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_truer_;
+        state_ = State::TrueR;
         return true;
     }
     return make_error("Unexpected t    {""}oken in True_T");
@@ -541,7 +877,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return true;
     if(token_helper<char_type_>::is_token_char_u(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_trueu_;
+        state_ = State::TrueU;
         return true;
     }
     return make_error("Unexpected token in True_R");
@@ -556,7 +892,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(token_helper<char_type_>::is_token_char_e(*char_))
     {
         pop_state();
-        return parser_callbacks::boolean_handler(true) || make_error("boolean_handler_array failed");
+        return parser_callbacks::boolean_handler(true) || handler_error_("boolean_handler_array failed");
     }
     return make_error("Unexpected token in True_U");
 }
@@ -569,7 +905,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return true;
     if(token_helper<char_type_>::is_token_char_u(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_nullu_;
+        state_ = State::NullU;
         return true;
     }
     return make_error("Unexpected token in Null_N");
@@ -583,7 +919,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return true;
     if(token_helper<char_type_>::is_token_char_l(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_nulll_;
+        state_ = State::NullL;
         return true;
     }
     return make_error("Unexpected token in Null_U");
@@ -598,7 +934,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(token_helper<char_type_>::is_token_char_l(*char_))
     {
         pop_state();
-        return parser_callbacks::null_handler() || make_error("null_handler failed");
+        return parser_callbacks::null_handler() || handler_error_("null_handler failed");
     }
     return make_error("Unexpected token in Null_L");
 }
@@ -611,7 +947,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     {
         if(first_ != nullptr)
         {
-            bool res = parser_callbacks::key_content_handler(
+            bool res = key_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(
                             first_, end_buf_ + 1 - first_));
             first_ = nullptr;
@@ -619,16 +955,19 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         }
         return true;
     }
+    if(!utf8_complete_() && (token_helper<char_type_>::is_token_backslash(*char_) ||
+                             token_helper<char_type_>::is_token_double_quote(*char_)))
+        return make_error("Invalid UTF-8 in string", parse_error::invalid_utf8);
     if(token_helper<char_type_>::is_token_backslash(*char_))
     {
         inside_key_ = true;
         bool res = true;
-	if(first_ != nullptr)
-	    res = parser_callbacks::key_content_handler(
+        if(first_ != nullptr)
+            res = key_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(
-                        first_, char_ - first_));
+                        first_, end_buf_ + 1 - first_));
         first_ = nullptr;
-        consumer_stack_.push_back(&parser_bits::consume_stringescape_);
+        push_state_(State::StringEscape);
         return res;
     }
     else if(token_helper<char_type_>::is_token_double_quote(*char_))
@@ -637,25 +976,28 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         bool res = true;
         if(first_ != nullptr)
         {
-            res = parser_callbacks::key_content_handler(
+            res = key_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(
-                            first_, char_ - first_));
+                            first_, end_buf_ + 1 - first_));
             first_ = nullptr;
         }
-        res = res && parser_callbacks::end_key_handler();
-        return res || make_error("key handling failure");
+        handler_result result = res ? to_handler_result(parser_callbacks::end_key_handler()) : handler_result::fail;
+        skip_next_value_ = result == handler_result::skip;
+        return result != handler_result::fail || handler_error_("key handling failure");
     }
     else if(token_helper<char_type_>::is_token_forbidden_in_string(*char_))
         return make_error("Forbidden token in string");
     else
     {
+        if(!utf8_char_(*char_))
+            return make_error("Invalid UTF-8 in string", parse_error::invalid_utf8);
         if(first_ == nullptr)
         {
             first_ = char_;
             end_buf_ = char_;
         }
-        else
-            ++end_buf_;
+        else if(++end_buf_ != char_) // in situ, after an escape sequence
+            *end_buf_ = *char_;
     }
     return true;
 }
@@ -669,22 +1011,25 @@ bool parser_bits<container, parser_callbacks, buffer_type_, char_type_>::consume
         bool res = true;
         if(first_ != nullptr)
         {
-            res = parser_callbacks::string_content_handler(
+            res = string_content_(
                        helper_functions<buffer_type, char_type>::make_string_view(
                            first_, end_buf_ + 1 - first_));
             first_ = nullptr;
         }
         return res;
     }
+    if(!utf8_complete_() && (token_helper<char_type_>::is_token_backslash(*char_) ||
+                             token_helper<char_type_>::is_token_double_quote(*char_)))
+        return make_error("Invalid UTF-8 in string", parse_error::invalid_utf8);
     if(token_helper<char_type_>::is_token_backslash(*char_))
     {
         inside_key_ = false;
-        consumer_stack_.push_back(&parser_bits::consume_stringescape_);
+        push_state_(State::StringEscape);
         bool res = true;
         if(first_ != nullptr)
         {
-            res = parser_callbacks::string_content_handler(
-                        helper_functions<buffer_type, char_type>::make_string_view(first_, char_ - first_));
+            res = string_content_(
+                        helper_functions<buffer_type, char_type>::make_string_view(first_, end_buf_ + 1 - first_));
         }
         first_ = nullptr;
         return res;
@@ -695,25 +1040,27 @@ bool parser_bits<container, parser_callbacks, buffer_type_, char_type_>::consume
         bool res = true;
         if(first_ != nullptr)
         {
-            res = parser_callbacks::string_content_handler(
+            res = string_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(
-                            first_, char_ - first_));
+                            first_, end_buf_ + 1 - first_));
         }
         first_ = nullptr;
         res = res && parser_callbacks::end_string_handler();
-        return res || make_error("string handling failure");
+        return res || handler_error_("string handling failure");
     }
     else if(token_helper<char_type_>::is_token_forbidden_in_string(*char_))
         return make_error("Forbidden token in string");
     else
     {
+        if(!utf8_char_(*char_))
+            return make_error("Invalid UTF-8 in string", parse_error::invalid_utf8);
         if(first_ == nullptr)
         {
             first_ = char_;
             end_buf_ = char_;
         }
-        else
-            ++end_buf_;
+        else if(++end_buf_ != char_) // in situ, after an escape sequence
+            *end_buf_ = *char_;
     }
     return true;
 }
@@ -726,7 +1073,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return !error_;
     if(token_helper<char_type_>::is_token_char_u(*char_))
     {
-        consumer_stack_.back() = &parser_bits::consume_stringuvalue_;
+        state_ = State::StringUValue;
         lastCodePoint = 0;
         return true;
     }
@@ -734,90 +1081,90 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
             token_helper<char_type_>::is_token_slash(*char_) ||
             token_helper<char_type_>::is_token_double_quote(*char_))
     {
-        consumer_stack_.pop_back();
+        pop_state();
         if(inside_key_)
         {
-            return parser_callbacks::key_content_handler(
+            return key_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(char_, 1));
         }
         else
         {
-            return parser_callbacks::string_content_handler(
+            return string_content_(
                     helper_functions<buffer_type, char_type>::make_string_view(char_, 1));
         }
     }
     if(token_helper<char_type_>::is_token_char_b(*char_))
     {
-        consumer_stack_.pop_back();
+        pop_state();
         char_type c = static_cast<char_type>('\b');
         if(inside_key_)
         {
-            return parser_callbacks::key_content_handler(
+            return key_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(&c, 1));
         }
         else
         {
-            return parser_callbacks::string_content_handler(
+            return string_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(&c, 1));
         }
     }
     if(token_helper<char_type_>::is_token_char_f(*char_))
     {
-        consumer_stack_.pop_back();
+        pop_state();
         char_type c = static_cast<char_type>('\f');
         if(inside_key_)
         {
-            return parser_callbacks::key_content_handler(
+            return key_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(&c, 1));
         }
         else
         {
-            return parser_callbacks::string_content_handler(
+            return string_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(&c, 1));
         }
     }
     if(token_helper<char_type_>::is_token_char_n(*char_))
     {
-        consumer_stack_.pop_back();
+        pop_state();
         char_type c = static_cast<char_type>('\n');
         if(inside_key_)
         {
-            return parser_callbacks::key_content_handler(
+            return key_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(&c, 1));
         }
         else
         {
-            return parser_callbacks::string_content_handler(
+            return string_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(&c, 1));
         }
     }
     if(token_helper<char_type_>::is_token_char_r(*char_))
     {
-        consumer_stack_.pop_back();
+        pop_state();
         char_type c = static_cast<char_type>('\r');
         if(inside_key_)
         {
-            return parser_callbacks::key_content_handler(
+            return key_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(&c, 1));
         }
         else
         {
-            return parser_callbacks::string_content_handler(
+            return string_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(&c, 1));
         }
     }
     if(token_helper<char_type_>::is_token_char_t(*char_))
     {
-        consumer_stack_.pop_back();
+        pop_state();
         char_type c = static_cast<char_type>('\t');
         if(inside_key_)
         {
-            return parser_callbacks::key_content_handler(
+            return key_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(&c, 1));
         }
         else
         {
-            return parser_callbacks::string_content_handler(
+            return string_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(&c, 1));
         }
     }
@@ -834,7 +1181,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(val != -1)
     {
         lastCodePoint = val << 12;
-        consumer_stack_.back() = &parser_bits::consume_stringuvalue1_;
+        state_ = State::StringUValue1;
         return true;
     }
     return make_error("Invalid token in unicode 1");
@@ -850,7 +1197,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(val != -1)
     {
         lastCodePoint += val << 8;
-        consumer_stack_.back() = &parser_bits::consume_stringuvalue2_;
+        state_ = State::StringUValue2;
         return true;
     }
     return make_error("Invalid token in unicode 2");
@@ -866,7 +1213,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(val != -1)
     {
         lastCodePoint += val << 4;
-        consumer_stack_.back() = &parser_bits::consume_stringuvalue3_;
+        state_ = State::StringUValue3;
         return true;
     }
     return make_error("Invalid token in unicode 3");
@@ -885,20 +1232,20 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         if(lastCodePoint >= 0xD800 && lastCodePoint < 0xDFFF) // utf16 pair, special care needed
         {
             lastCodePoint = lastCodePoint << 16;
-            consumer_stack_.back() = &parser_bits::consume_stringuvalue4_;
+            state_ = State::StringUValue4;
             return true;
         }
-        consumer_stack_.pop_back();
+        pop_state();
         helper_functions<buffer_type, char_type_>::truncate(lastValue_);
         helper_functions<buffer_type_,char_type_>::append_code_point(lastValue_, lastCodePoint);
         if(inside_key_)
         {
-            return parser_callbacks::key_content_handler(
+            return key_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(lastValue_.data(), lastValue_.size()));
         }
         else
         {
-            return parser_callbacks::string_content_handler(
+            return string_content_(
                         helper_functions<buffer_type, char_type>::make_string_view(lastValue_.data(), lastValue_.size()));
         }
     }
@@ -913,7 +1260,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return !error_;
     if(!token_helper<char_type_>::is_token_backslash(*char_))
         return make_error("Invalid token, expected backslash");
-    consumer_stack_.back() = &parser_bits::consume_stringuvalue5_;
+    state_ = State::StringUValue5;
     return true;
 }
 
@@ -925,7 +1272,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return !error_;
     if(!token_helper<char_type_>::is_token_char_u(*char_))
         return make_error("Invalid token, expected char_u");
-    consumer_stack_.back() = &parser_bits::consume_stringuvalue6_;
+    state_ = State::StringUValue6;
     return true;
 }
 
@@ -939,7 +1286,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(val != -1)
     {
         lastCodePoint += val << 12;
-        consumer_stack_.back() = &parser_bits::consume_stringuvalue7_;
+        state_ = State::StringUValue7;
         return true;
     }
     else
@@ -956,7 +1303,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(val != -1)
     {
         lastCodePoint += val << 8;
-        consumer_stack_.back() = &parser_bits::consume_stringuvalue8_;
+        state_ = State::StringUValue8;
         return true;
     }
     else
@@ -973,7 +1320,7 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(val != -1)
     {
         lastCodePoint += val << 4;
-        consumer_stack_.back() = &parser_bits::consume_stringuvalue9_;
+        state_ = State::StringUValue9;
         return true;
     }
     else
@@ -990,18 +1337,25 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
     if(val != -1)
     {
         lastCodePoint += val;
-        consumer_stack_.pop_back();
+        pop_state();
         uint32_t codePointHigh = ((lastCodePoint >> 16) - 0xD800) << 10;
         uint32_t v = lastCodePoint & 0xFFFF;
-        if(v < 0xDC00u)
+        if(v < 0xDC00u || v > 0xDFFFu)
             return make_error("Invalid unicode code point");
         uint32_t codePointLow = (v - 0xDC00);
         uint32_t val32 = codePointHigh + codePointLow + 0x10000;
         helper_functions<buffer_type_,char_type_>::truncate(lastValue_);
         helper_functions<buffer_type_,char_type_>::append_code_point(lastValue_, val32);
-        return parser_callbacks::string_content_handler(
-                    helper_functions<buffer_type, char_type>::make_string_view(lastValue_.data(), lastValue_.size()));
-        return true;
+        if(inside_key_)
+        {
+            return key_content_(
+                        helper_functions<buffer_type, char_type>::make_string_view(lastValue_.data(), lastValue_.size()));
+        }
+        else
+        {
+            return string_content_(
+                        helper_functions<buffer_type, char_type>::make_string_view(lastValue_.data(), lastValue_.size()));
+        }
     }
     else
         return make_error("Invalid token in StringUValue9");
@@ -1012,14 +1366,17 @@ typename parser_callbacks,typename buffer_type_, typename char_type_>
 bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_numberstarting0_(char_type_* char_)
 {
     if(char_ == nullptr)
+    {
+        flush_number_();
         return !error_;
+    }
     if(token_helper<char_type_>::is_token_point(*char_)) // point ok after leading 0
     {
 #ifdef JSON_USE_LONG_INTEGERS
         lastNumIsFloat = true;
 #endif
-        helper_functions<buffer_type,char_type_>::append(lastValue_, *char_);
-        consumer_stack_.back() = &parser_bits::consume_number_;
+        extend_number_(char_);
+        state_ = State::Number;
         return true;
     }
     if(token_helper<char_type_>::is_token_char_E(*char_) ||
@@ -1028,8 +1385,8 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
 #ifdef JSON_USE_LONG_INTEGERS
         lastNumIsFloat = true;
 #endif
-        helper_functions<buffer_type,char_type_>::append(lastValue_, *char_);
-        consumer_stack_.back() = &parser_bits::consume_number_;
+        extend_number_(char_);
+        state_ = State::Number;
         return true;
     }
     if(token_helper<char_type_>::is_token_digit19(*char_) ||
@@ -1040,43 +1397,18 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
         return make_error("Invalid numeric format");
     }
     pop_state(); // char not part of a number, consider number finished
-#ifdef JSON_USE_LONG_INTEGERS
-    if(lastNumIsFloat)
-    {
-#endif
-        auto val = helper_functions<buffer_type_, char_type_>::string_to_double(lastValue_);
-        if(val.first)
-        {
-            return parser_callbacks::double_handler(val.second) && consume_(char_); // reconsume char, but outside number !
-        }
-        return make_error("Invalid double value");
-#ifdef JSON_USE_LONG_INTEGERS
-    }
-    else
-    {
-        std::pair<bool, int64_t> val = helper_functions<buffer_type_, char_type_>::string_to_integer(lastValue);
-        if(val.first)
-        {
-            return parser_callbacks::integer_handler(val.second) && consume(char_);
-        }
-        auto val2 = helper_functions<buffer_type_, char_type_>::string_to_double(lastValue);
-        if(val2.first)
-            return parser_callbacks::double_handler(val2.second) && consume(char_); // reconsume char, but outside number !
-        return make_error("Invalid integer");
-    }
-#endif
+    return end_number_(char_);
 }
 
 template<template<class> class container,
 typename parser_callbacks,typename buffer_type_, typename char_type_>
 bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_number_(char_type_* char_)
 {
-#ifdef JSON_USE_LONG_INTEGERS
-    if(token_helper<char_type_>::is_token_point(*char_))
-        lastNumIsFloat = true;
-#endif
     if(char_ == nullptr)
+    {
+        flush_number_();
         return !error_;
+    }
     if(token_helper<char_type_>::is_token_digit19(*char_) ||
             token_helper<char_type_>::is_token_zero(*char_) ||
             token_helper<char_type_>::is_token_char_E(*char_) ||
@@ -1085,37 +1417,252 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_
             token_helper<char_type_>::is_token_plussign(*char_) ||
             token_helper<char_type_>::is_token_point(*char_))
     {
-        helper_functions<buffer_type,char_type>::append(lastValue_, *char_);
+#ifdef JSON_USE_LONG_INTEGERS
+        if(token_helper<char_type_>::is_token_digit19(*char_) || token_helper<char_type_>::is_token_zero(*char_))
+        {
+            lastInteger_ = lastInteger_ * 10 + static_cast<std::uint64_t>(helper_functions<buffer_type_, char_type_>::hexdigit_val(*char_));
+            ++lastNumDigits_;
+        }
+        else // point, exponent or misplaced sign : the conversion function will check the format
+            lastNumIsFloat = true;
+#endif
+        extend_number_(char_);
         return true;
     }
     pop_state(); // quit number state : char is not part of number
+    return end_number_(char_);
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+void parser_bits<container,parser_callbacks, buffer_type_, char_type_>::start_number_(char_type_* char_)
+{
+    helper_functions<buffer_type_, char_type_>::truncate(lastValue_);
+    first_ = char_;
+    end_buf_ = char_;
 #ifdef JSON_USE_LONG_INTEGERS
-    if(lastNumIsFloat)
-    {
+    lastNumIsFloat = false;
+    lastNumNegative_ = token_helper<char_type_>::is_token_minussign(*char_);
+    lastNumDigits_ = lastNumNegative_ ? 0 : 1;
+    lastInteger_ = lastNumNegative_ ? 0 : static_cast<std::uint64_t>(helper_functions<buffer_type_, char_type_>::hexdigit_val(*char_));
 #endif
-        auto val = helper_functions<buffer_type_, char_type_>::string_to_double(lastValue_);
-        if(val.first)
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+void parser_bits<container,parser_callbacks, buffer_type_, char_type_>::extend_number_(char_type_* char_)
+{
+    if(first_ == nullptr)
+        first_ = char_;
+    end_buf_ = char_;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+void parser_bits<container,parser_callbacks, buffer_type_, char_type_>::flush_number_()
+{
+    if(first_ != nullptr)
+    {
+        if(static_cast<std::size_t>(end_buf_ + 1 - first_) + lastValue_.size() > max_number_length_)
         {
-            return parser_callbacks::double_handler(val.second) && consume_(char_); // reconsume char, but outside number !
+            make_error("Maximum number length exceeded", parse_error::number_length_limit);
+            return;
         }
-        return make_error("Invalid double value");
+        helper_functions<buffer_type_, char_type_>::append(lastValue_, first_, end_buf_ + 1);
+        first_ = nullptr;
+    }
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::end_number_(char_type_* char_)
+{
+    if((first_ != nullptr ? static_cast<std::size_t>(end_buf_ + 1 - first_) : 0) + lastValue_.size() > max_number_length_)
+        return make_error("Maximum number length exceeded", parse_error::number_length_limit);
 #ifdef JSON_USE_LONG_INTEGERS
+    if(!lastNumIsFloat && lastNumDigits_ > 0 && lastNumDigits_ <= max_accumulated_digits)
+    {
+        first_ = nullptr;
+        if constexpr(has_exact_integer_handler<parser_callbacks>::value)
+            return (parser_callbacks::exact_integer_handler(lastNumNegative_, lastInteger_) ||
+                    handler_error_("exact_integer_handler failed")) && consume_(char_);
+        auto value = static_cast<std::int64_t>(lastInteger_);
+        return (parser_callbacks::integer_handler(lastNumNegative_ ? -value : value) ||
+                handler_error_("integer_handler failed")) && consume_(char_);
     }
-    else
+#endif
+    char_type_ const* begin = first_;
+    char_type_ const* end = end_buf_ + 1;
+    if(lastValue_.size() != 0) // number started in a previous buffer
+    {
+        flush_number_();
+        begin = lastValue_.data();
+        end = begin + lastValue_.size();
+    }
+    first_ = nullptr;
+    if constexpr(has_exact_integer_handler<parser_callbacks>::value)
     {
-        auto val = helper_functions<buffer_type_, char_type_>::string_to_integer(lastValue_);
+        auto magnitude = helper_functions<buffer_type_, char_type_>::chars_to_magnitude(begin, end);
+        if(magnitude.first)
+            return (parser_callbacks::exact_integer_handler(token_helper<char_type_>::is_token_minussign(*begin),
+                                                            magnitude.second) ||
+                    handler_error_("exact_integer_handler failed")) && consume_(char_);
+        // not integral, or too large : read as double
+    }
+#ifdef JSON_USE_LONG_INTEGERS
+    if(!lastNumIsFloat)
+    {
+        auto val = helper_functions<buffer_type_, char_type_>::chars_to_integer(begin, end);
         if(val.first)
+            return (parser_callbacks::integer_handler(val.second) || handler_error_("integer_handler failed")) &&
+                    consume_(char_); // reconsume char, but outside number !
+        // may be an overflow : try to read as double
+    }
+#endif
+    auto val = helper_functions<buffer_type_, char_type_>::chars_to_double(begin, end);
+    if(val.first)
+    {
+        return (parser_callbacks::double_handler(val.second) || handler_error_("double_handler failed")) &&
+                consume_(char_); // reconsume char, but outside number !
+    }
+    return make_error("Invalid double value");
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_skipvalue_(char_type_* char_)
+{
+    if(char_ == nullptr)
+        return !error_;
+    if(token_helper<char_type_>::is_token_space(*char_))
+        return true;
+    if(!count_element_())
+        return false;
+    if(token_helper<char_type_>::is_token_double_quote(*char_))
+        start_skip_(0, true);
+    else if(token_helper<char_type_>::is_token_opening_square_bracket(*char_) ||
+            token_helper<char_type_>::is_token_opening_curly_bracket(*char_))
+        start_skip_(1, false);
+    else if(token_helper<char_type_>::is_token_comma(*char_) ||
+            token_helper<char_type_>::is_token_colon(*char_) ||
+            token_helper<char_type_>::is_token_closing_square_bracket(*char_) ||
+            token_helper<char_type_>::is_token_closing_curly_bracket(*char_))
+        return make_error("Unexpected token in SkipValue");
+    else
+        start_skip_(0, false);
+    return true;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_skip_(char_type_* char_)
+{
+    if(char_ == nullptr)
+        return !error_;
+    if(skip_in_string_)
+    {
+        if(skip_escape_)
+            skip_escape_ = false;
+        else if(token_helper<char_type_>::is_token_backslash(*char_))
+            skip_escape_ = true;
+        else if(token_helper<char_type_>::is_token_double_quote(*char_))
         {
-            return parser_callbacks::integer_handler(val.second) && consume(*char_);
+            skip_in_string_ = false;
+            if(skip_depth_ == 0)
+                pop_state();
         }
-        else // may be an overflow : try to read as double
+        return true;
+    }
+    if(skip_depth_ == 0) // number or literal, up to the next delimiter
+    {
+        if(token_helper<char_type_>::is_token_space(*char_) ||
+                token_helper<char_type_>::is_token_comma(*char_) ||
+                token_helper<char_type_>::is_token_closing_square_bracket(*char_) ||
+                token_helper<char_type_>::is_token_closing_curly_bracket(*char_))
         {
-            auto val2 = helper_functions<buffer_type_, char_type_>::string_to_double(lastValue_);
-            return parser_callbacks::double_handler(val2.second) && consume(char_); // reconsume char, but outside number !
+            pop_state();
+            return consume_(char_); // the delimiter belongs to the enclosing state
         }
-        return make_error("Invalid integer");
+        return true;
     }
-#endif
+    if(token_helper<char_type_>::is_token_double_quote(*char_))
+        skip_in_string_ = true;
+    else if(token_helper<char_type_>::is_token_opening_square_bracket(*char_) ||
+            token_helper<char_type_>::is_token_opening_curly_bracket(*char_))
+        ++skip_depth_;
+    else if(token_helper<char_type_>::is_token_closing_square_bracket(*char_) ||
+            token_helper<char_type_>::is_token_closing_curly_bracket(*char_))
+    {
+        if(--skip_depth_ == 0)
+            pop_state();
+    }
+    return true;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+char_type_* parser_bits<container,parser_callbacks, buffer_type_, char_type_>::skip_run_(char_type_* begin, char_type_* end)
+{
+    while(begin != end)
+    {
+        if(skip_in_string_)
+        {
+            if(skip_escape_)
+            {
+                skip_escape_ = false;
+                ++begin;
+                continue;
+            }
+            begin = scan_helper<char_type_>::find_string_special(begin, end);
+            if(begin == end)
+                break;
+            if(token_helper<char_type_>::is_token_backslash(*begin))
+                skip_escape_ = true;
+            else if(token_helper<char_type_>::is_token_double_quote(*begin))
+            {
+                skip_in_string_ = false;
+                if(skip_depth_ == 0)
+                {
+                    pop_state();
+                    return begin + 1;
+                }
+            }
+            ++begin;
+        }
+        else if(skip_depth_ == 0)
+        {
+            for(; begin != end; ++begin)
+            {
+                if(token_helper<char_type_>::is_token_space(*begin) ||
+                        token_helper<char_type_>::is_token_comma(*begin) ||
+                        token_helper<char_type_>::is_token_closing_square_bracket(*begin) ||
+                        token_helper<char_type_>::is_token_closing_curly_bracket(*begin))
+                {
+                    pop_state();
+                    break; // the delimiter belongs to the enclosing state
+                }
+            }
+            return begin;
+        }
+        else
+        {
+            begin = scan_helper<char_type_>::find_bracket_or_quote(begin, end);
+            if(begin == end)
+                break;
+            if(token_helper<char_type_>::is_token_double_quote(*begin))
+                skip_in_string_ = true;
+            else if(token_helper<char_type_>::is_token_opening_square_bracket(*begin) ||
+                    token_helper<char_type_>::is_token_opening_curly_bracket(*begin))
+                ++skip_depth_;
+            else if(--skip_depth_ == 0)
+            {
+                pop_state();
+                return begin + 1;
+            }
+            ++begin;
+        }
+    }
+    return begin;
 }
 
 template<template<class> class container,
@@ -1129,38 +1676,437 @@ template<template<class> class container,
 typename parser_callbacks,typename buffer_type_, typename char_type_>
 bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_(char_type_* c)
 {
-    return (this->*consumer_stack_.back())(c);
+    return dispatch_(c);
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::dispatch_(char_type_* c)
+{
+    switch(state_)
+    {
+        case State::Initial:
+            return consume_initial_(c);
+        case State::ArrayStart:
+            return consume_arraystart_(c);
+        case State::ArraySeparator:
+            return consume_arrayseparator_(c);
+        case State::ObjectSeparator:
+            return consume_objectseparator_(c);
+        case State::Array:
+            return consume_array_(c);
+        case State::ObjectStart:
+            return consume_objectstart_(c);
+        case State::ObjectBetween:
+            return consume_objectbetween_(c);
+        case State::ObjectKey:
+            return consume_objectkey_(c);
+        case State::ObjectValue:
+            return consume_objectvalue_(c);
+        case State::FalseF:
+            return consume_falsef_(c);
+        case State::FalseA:
+            return consume_falsea_(c);
+        case State::FalseL:
+            return consume_falsel_(c);
+        case State::FalseS:
+            return consume_falses_(c);
+        case State::TrueT:
+            return consume_truet_(c);
+        case State::TrueR:
+            return consume_truer_(c);
+        case State::TrueU:
+            return consume_trueu_(c);
+        case State::NullN:
+            return consume_nulln_(c);
+        case State::NullU:
+            return consume_nullu_(c);
+        case State::NullL:
+            return consume_nulll_(c);
+        case State::StringKey:
+            return consume_stringkey_(c);
+        case State::String:
+            return consume_string_(c);
+        case State::StringEscape:
+            return consume_stringescape_(c);
+        case State::StringUValue:
+            return consume_stringuvalue_(c);
+        case State::StringUValue1:
+            return consume_stringuvalue1_(c);
+        case State::StringUValue2:
+            return consume_stringuvalue2_(c);
+        case State::StringUValue3:
+            return consume_stringuvalue3_(c);
+        case State::StringUValue4:
+            return consume_stringuvalue4_(c);
+        case State::StringUValue5:
+            return consume_stringuvalue5_(c);
+        case State::StringUValue6:
+            return consume_stringuvalue6_(c);
+        case State::StringUValue7:
+            return consume_stringuvalue7_(c);
+        case State::StringUValue8:
+            return consume_stringuvalue8_(c);
+        case State::StringUValue9:
+            return consume_stringuvalue9_(c);
+        case State::NumberStarting0:
+            return consume_numberstarting0_(c);
+        case State::Number:
+            return consume_number_(c);
+        case State::SkipValue:
+            return consume_skipvalue_(c);
+        case State::Skip:
+            return consume_skip_(c);
+        case State::InError:
+            return consume_inerror_(c);
+    }
+    return false;
 }
 
 template<template<class> class container,
 typename parser_callbacks,typename buffer_type_, typename char_type_>
 bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume(char_type_ c)
 {
-    return consume_(&c) &&
+    bool good = consume_(&c) &&
            consume_(nullptr);
+    if(!good)
+        note_error_offset_(0);
+    ++consumed_;
+    return good;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+char_type_* parser_bits<container,parser_callbacks, buffer_type_, char_type_>::scan_string_run_(char_type_* begin, char_type_* end, bool& good)
+{
+    char_type_* stop;
+    if constexpr(sizeof(char_type_) == 1 && std::is_integral_v<char_type_>)
+    {
+        bool non_ascii = false;
+        stop = validate_utf8_ ? scan_helper<char_type_>::find_string_special(begin, end, non_ascii) :
+                                scan_helper<char_type_>::find_string_special(begin, end);
+        if(non_ascii || !utf8_complete_()) // ascii runs are valid, unless they interrupt a multibyte character
+        {
+            char_type_* invalid = utf8_.validate(begin, stop);
+            // a multibyte character cannot be interrupted by a quote, a backslash or a control character
+            if(invalid != stop || (stop != end && !utf8_.complete()))
+            {
+                good = make_error("Invalid UTF-8 in string", parse_error::invalid_utf8);
+                return invalid + 1;
+            }
+        }
+    }
+    else
+        stop = scan_helper<char_type_>::find_string_special(begin, end);
+    if(stop != begin)
+    {
+        if(first_ == nullptr)
+            first_ = begin;
+        else if(end_buf_ + 1 != begin) // in situ, after an escape sequence : move the run next to the decoded data
+        {
+            std::memmove(end_buf_ + 1, begin, static_cast<std::size_t>(stop - begin) * sizeof(char_type_));
+            end_buf_ += stop - begin;
+            return stop;
+        }
+        end_buf_ = stop - 1;
+    }
+    return stop;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::in_structural_state_() const
+{
+    return state_ <= State::ObjectValue;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::in_value_start_state_() const
+{
+    return state_ == State::ArrayStart || state_ == State::ArraySeparator || state_ == State::ObjectSeparator;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+char_type_* parser_bits<container,parser_callbacks, buffer_type_, char_type_>::match_literal_(char_type_* begin, char_type_* end, bool& good)
+{
+    auto word = [](char const* literal) {
+        std::uint32_t w;
+        std::memcpy(&w, literal, sizeof(w));
+        return w;
+    };
+    std::uint32_t value;
+    std::memcpy(&value, begin, sizeof(value));
+    char_type_* next = begin;
+    if(value == word("true"))
+        next = begin + 4;
+    else if(value == word("null"))
+        next = begin + 4;
+    else if(value == word("fals") && end - begin >= 5 && token_helper<char_type_>::is_token_char_e(begin[4]))
+        next = begin + 5;
+    if(next == begin)
+        return begin;
+    if(!count_element_())
+    {
+        good = false;
+        return next;
+    }
+    state_ = state_ == State::ObjectSeparator ? State::ObjectValue : State::Array;
+    if(token_helper<char_type_>::is_token_char_n(*begin))
+        good = parser_callbacks::null_handler() || handler_error_("null_handler failed");
+    else
+        good = parser_callbacks::boolean_handler(token_helper<char_type_>::is_token_char_t(*begin)) ||
+                handler_error_("boolean_handler failed");
+    return next;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+char_type_* parser_bits<container,parser_callbacks, buffer_type_, char_type_>::decode_escapes_(char_type_* begin, char_type_* end, bool& good)
+{
+    auto hex4 = [](char_type_ const* p, std::uint32_t& codepoint) {
+        codepoint = 0;
+        for(int i = 0; i < 4; ++i)
+        {
+            int8_t val = helper_functions<buffer_type_, char_type_>::hexdigit_val(p[i]);
+            if(val == -1)
+                return false;
+            codepoint = (codepoint << 4) + static_cast<std::uint32_t>(val);
+        }
+        return true;
+    };
+    helper_functions<buffer_type_, char_type_>::truncate(lastValue_);
+    char_type_* cur = begin;
+    while(end - cur >= 2 && token_helper<char_type_>::is_token_backslash(*cur))
+    {
+        char_type_ c = cur[1];
+        if(token_helper<char_type_>::is_token_char_u(c))
+        {
+            std::uint32_t codepoint;
+            if(end - cur < 6 || !hex4(cur + 2, codepoint))
+                break;
+            if(codepoint >= 0xD800 && codepoint < 0xDFFF) // utf16 pair, special care needed
+            {
+                std::uint32_t low;
+                if(end - cur < 12 || !token_helper<char_type_>::is_token_backslash(cur[6]) ||
+                        !token_helper<char_type_>::is_token_char_u(cur[7]) || !hex4(cur + 8, low) ||
+                        low < 0xDC00u || low > 0xDFFFu)
+                    break;
+                codepoint = ((codepoint - 0xD800) << 10) + (low - 0xDC00) + 0x10000;
+                cur += 12;
+            }
+            else
+                cur += 6;
+            helper_functions<buffer_type_, char_type_>::append_code_point(lastValue_, codepoint);
+            continue;
+        }
+        if(token_helper<char_type_>::is_token_backslash(c) ||
+                token_helper<char_type_>::is_token_slash(c) ||
+                token_helper<char_type_>::is_token_double_quote(c))
+            helper_functions<buffer_type_, char_type_>::append(lastValue_, c);
+        else if(token_helper<char_type_>::is_token_char_b(c))
+            helper_functions<buffer_type_, char_type_>::append(lastValue_, static_cast<char_type_>('\b'));
+        else if(token_helper<char_type_>::is_token_char_f(c))
+            helper_functions<buffer_type_, char_type_>::append(lastValue_, static_cast<char_type_>('\f'));
+        else if(token_helper<char_type_>::is_token_char_n(c))
+            helper_functions<buffer_type_, char_type_>::append(lastValue_, static_cast<char_type_>('\n'));
+        else if(token_helper<char_type_>::is_token_char_r(c))
+            helper_functions<buffer_type_, char_type_>::append(lastValue_, static_cast<char_type_>('\r'));
+        else if(token_helper<char_type_>::is_token_char_t(c))
+            helper_functions<buffer_type_, char_type_>::append(lastValue_, static_cast<char_type_>('\t'));
+        else
+            break;
+        cur += 2;
+    }
+    if(cur == begin)
+        return begin;
+    good = true;
+    if(in_situ_) // decoded data is always shorter than the escape sequences : write it in place
+    {
+        char_type_* dest = first_ != nullptr ? end_buf_ + 1 : begin;
+        if(first_ == nullptr)
+            first_ = begin;
+        std::copy(lastValue_.data(), lastValue_.data() + lastValue_.size(), dest);
+        end_buf_ = dest + lastValue_.size() - 1;
+        return cur;
+    }
+    bool const is_key = state_ == State::StringKey;
+    auto report = [this, is_key](char_type_ const* data, std::size_t size) {
+        auto view = helper_functions<buffer_type, char_type>::make_string_view(data, size);
+        return is_key ? key_content_(view) : string_content_(view);
+    };
+    if(first_ != nullptr) // plain characters before the escapes
+    {
+        good = report(first_, static_cast<std::size_t>(end_buf_ + 1 - first_));
+        first_ = nullptr;
+    }
+    good = good && report(lastValue_.data(), lastValue_.size());
+    if(!good)
+        handler_error_(is_key ? "key handling failure" : "string handling failure");
+    return cur;
 }
 
 template<template<class> class container,
   typename parser_callbacks, typename buffer_type_, typename char_type_>
-template<typename char_type_iterator>
-bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume(char_type_iterator begin, char_type_iterator end)
+template<bool stop_at_document_end, typename char_type_iterator>
+char_type_iterator parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_run_(
+        char_type_iterator begin, char_type_iterator end, bool& good)
 {
-    bool good = true;
     while(begin != end && good)
     {
-        good = consume_(begin);
+        if constexpr(std::is_same_v<char_type_iterator, char_type_*>)
+        {
+            // inside a string, jump directly to the next character needing special handling
+            if(state_ == State::String || state_ == State::StringKey)
+            {
+                begin = scan_string_run_(begin, end, good);
+                if(begin == end || !good)
+                    break;
+                if(token_helper<char_type_>::is_token_backslash(*begin))
+                {
+                    char_type_* next = decode_escapes_(begin, end, good);
+                    if(next != begin)
+                    {
+                        begin = next;
+                        continue;
+                    }
+                }
+            }
+            else if(state_ == State::Skip)
+            {
+                begin = skip_run_(begin, end);
+                if constexpr(stop_at_document_end)
+                {
+                    if(end_) // the skipped top level value is complete
+                        break;
+                }
+                continue;
+            }
+            else
+            {
+                if(token_helper<char_type_>::is_token_space(*begin) && in_structural_state_())
+                {
+                    begin = scan_helper<char_type_>::skip_whitespace(begin, end);
+                    if(begin == end)
+                        break;
+                }
+                if constexpr(sizeof(char_type_) == 1 && std::is_integral_v<char_type_>)
+                {
+                    if(end - begin >= 4 && in_value_start_state_())
+                    {
+                        char_type_* next = match_literal_(begin, end, good);
+                        if(next != begin)
+                        {
+                            begin = next;
+                            continue;
+                        }
+                    }
+                }
+            }
+        }
+        good = dispatch_(begin);
         ++begin;
+        if constexpr(stop_at_document_end)
+        {
+            if(end_) // the top level value is complete
+                break;
+        }
     }
-    good = (this->*consumer_stack_.back())(nullptr);
+    return begin;
+}
+
+template<template<class> class container,
+  typename parser_callbacks, typename buffer_type_, typename char_type_>
+template<typename char_type_iterator>
+bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume(char_type_iterator begin, char_type_iterator end)
+{
+    bool good = true;
+    char_type_iterator stop = consume_run_<false>(begin, end, good);
+    std::size_t const size = static_cast<std::size_t>(std::distance(begin, end));
+    if(!good) // the run stops right after the character in error
+        note_error_offset_(static_cast<std::size_t>(std::distance(begin, stop)) - 1);
+    good = good && consume_(nullptr);
+    if(!good)
+        note_error_offset_(size);
+    consumed_ += size;
     return good;
 }
 
+template<template<class> class container,
+  typename parser_callbacks, typename buffer_type_, typename char_type_>
+template<typename char_type_iterator>
+std::pair<bool, std::size_t> parser_bits<container,parser_callbacks, buffer_type_, char_type_>::consume_document(
+        char_type_iterator begin, char_type_iterator end)
+{
+    bool good = !end_;
+    char_type_iterator stop = consume_run_<true>(begin, end, good);
+    std::size_t const size = static_cast<std::size_t>(std::distance(begin, stop));
+    if(!good && !end_)
+        note_error_offset_(size > 0 ? size - 1 : 0);
+    good = consume_(nullptr) && good;
+    if(!good)
+        note_error_offset_(size);
+    consumed_ += size;
+    return {good, size};
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+void parser_bits<container,parser_callbacks, buffer_type_, char_type_>::reset()
+{
+    state_ = State::Initial;
+    state_stack_.clear();
+    end_ = false;
+    error_ = false;
+    begin_ = true;
+    inside_key_ = false;
+    err_ = nullptr;
+    error_code_ = parse_error::none;
+    consumed_ = 0;
+    error_offset_ = no_error_offset;
+    string_length_ = 0;
+    element_count_ = 0;
+    first_ = nullptr;
+    end_buf_ = nullptr;
+    utf8_.reset();
+    skip_depth_ = 0;
+    skip_in_string_ = false;
+    skip_escape_ = false;
+    skip_next_value_ = false;
+    helper_functions<buffer_type_, char_type_>::truncate(lastValue_);
+    if constexpr(has_reset<parser_callbacks>::value)
+        parser_callbacks::reset();
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+void parser_bits<container,parser_callbacks, buffer_type_, char_type_>::set_in_situ(bool in_situ)
+{
+    in_situ_ = in_situ;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::in_situ() const
+{
+    return in_situ_;
+}
+
 template<template<class> class container,
 typename parser_callbacks,typename buffer_type_, typename char_type_>
 bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::end()
 {
-    if(consumer_stack_.size() != 1 || begin_)
+    if(!state_stack_.empty() || state_ != State::Initial || begin_)
+    {
         error_ = true;
+        if(err_ == nullptr)
+        {
+            err_ = begin_ ? "Empty document" : "Unexpected end of document";
+            error_code_ = parse_error::syntax;
+        }
+        note_error_offset_(0);
+    }
     end_ = true;
     return !error_;
 }
@@ -1174,15 +2120,72 @@ bool parser_bits<container,parser_callbacks, buffer_type_, char_type_>::complete
 
 template<template<class> class container,
 typename parser_callbacks,typename buffer_type_, typename char_type_>
-bool parser_bits<container, parser_callbacks, buffer_type_, char_type_>::make_error(char const* err)
+bool parser_bits<container, parser_callbacks, buffer_type_, char_type_>::make_error(char const* err, parse_error code)
 {
-    consumer_stack_.clear();
-    consumer_stack_.push_back(&parser_bits::consume_inerror_);
+    state_stack_.clear();
+    state_ = State::InError;
     error_ = true;
-    err_ = err;
+    if(err_ == nullptr)
+    {
+        err_ = err;
+        error_code_ = code;
+    }
     return false;
 }
 
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container, parser_callbacks, buffer_type_, char_type_>::handler_error_(char const* message)
+{
+    if constexpr(has_limits<parser_callbacks>::value)
+    {
+        parse_error const code = parser_callbacks::limit_error();
+        if(code != parse_error::none)
+            return make_error(message, code);
+    }
+    return make_error(message, parse_error::handler_failed);
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container, parser_callbacks, buffer_type_, char_type_>::push_container_(State state)
+{
+    if(state_stack_.size() >= max_depth_)
+        return make_error("Maximum depth exceeded", parse_error::depth_limit);
+    push_state_(state);
+    return true;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container, parser_callbacks, buffer_type_, char_type_>::count_element_()
+{
+    return ++element_count_ <= max_element_count_ ||
+            make_error("Maximum element count exceeded", parse_error::element_count_limit);
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+template<typename view_type>
+bool parser_bits<container, parser_callbacks, buffer_type_, char_type_>::string_content_(view_type value)
+{
+    string_length_ += value.size();
+    if(string_length_ > max_string_length_)
+        return make_error("Maximum string length exceeded", parse_error::string_length_limit);
+    return parser_callbacks::string_content_handler(value) || handler_error_("string_content_handler failed");
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+template<typename view_type>
+bool parser_bits<container, parser_callbacks, buffer_type_, char_type_>::key_content_(view_type value)
+{
+    string_length_ += value.size();
+    if(string_length_ > max_string_length_)
+        return make_error("Maximum string length exceeded", parse_error::string_length_limit);
+    return parser_callbacks::key_content_handler(value) || handler_error_("key_content_handler failed");
+}
+
 template<template<class> class container,
 typename parser_callbacks,typename buffer_type_, typename char_type_>
 char const * parser_bits<container, parser_callbacks, buffer_type_, char_type_>::error_message() const
@@ -1190,6 +2193,145 @@ char const * parser_bits<container, parser_callbacks, buffer_type_, char_type_>:
     return err_;
 }
 
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+parse_error parser_bits<container, parser_callbacks, buffer_type_, char_type_>::error_code() const
+{
+    return error_code_;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+std::size_t parser_bits<container, parser_callbacks, buffer_type_, char_type_>::error_offset() const
+{
+    return error_offset_;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+text_position parser_bits<container, parser_callbacks, buffer_type_, char_type_>::error_position(
+        char_type_ const* begin, char_type_ const* end) const
+{
+    return locate(begin, end, error_offset_);
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+void parser_bits<container, parser_callbacks, buffer_type_, char_type_>::set_limits(parser_limits const& limits)
+{
+    limits_ = limits;
+    max_depth_ = parser_limits::effective(limits.max_depth);
+    max_string_length_ = parser_limits::effective(limits.max_string_length);
+    max_number_length_ = parser_limits::effective(limits.max_number_length);
+    max_element_count_ = parser_limits::effective(limits.max_element_count);
+    if constexpr(has_limits<parser_callbacks>::value)
+        parser_callbacks::set_limits(limits);
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+parser_limits const& parser_bits<container, parser_callbacks, buffer_type_, char_type_>::limits() const
+{
+    return limits_;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+void parser_bits<container, parser_callbacks, buffer_type_, char_type_>::set_utf8_validation(bool validate)
+{
+    validate_utf8_ = validate && sizeof(char_type_) == 1 && std::is_integral_v<char_type_>;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool parser_bits<container, parser_callbacks, buffer_type_, char_type_>::utf8_validation() const
+{
+    return validate_utf8_;
+}
+
+/**
+ * The function_table_parser_bits class runs the same state machine as parser_bits, but with the dispatch
+ * of the original engine : one indirect call through a member function pointer for every character, and
+ * no bulk scanning. It is only kept so that both engines can be benchmarked side by side.
+ */
+template<template<class> class container,
+            typename parser_callbacks,
+            typename buffer_type_,
+            typename char_type_>
+class function_table_parser_bits :
+    public parser_bits<container, parser_callbacks, buffer_type_, char_type_>
+{
+    using base = parser_bits<container, parser_callbacks, buffer_type_, char_type_>;
+    using consumer_fn = bool(base::*)(char_type_*);
+    using State = typename base::State;
+
+    static constexpr consumer_fn consumers_[] = {
+        &function_table_parser_bits::consume_initial_,
+        &function_table_parser_bits::consume_arraystart_,
+        &function_table_parser_bits::consume_arrayseparator_,
+        &function_table_parser_bits::consume_objectseparator_,
+        &function_table_parser_bits::consume_array_,
+        &function_table_parser_bits::consume_objectstart_,
+        &function_table_parser_bits::consume_objectbetween_,
+        &function_table_parser_bits::consume_objectkey_,
+        &function_table_parser_bits::consume_objectvalue_,
+        &function_table_parser_bits::consume_falsef_,
+        &function_table_parser_bits::consume_falsea_,
+        &function_table_parser_bits::consume_falsel_,
+        &function_table_parser_bits::consume_falses_,
+        &function_table_parser_bits::consume_truet_,
+        &function_table_parser_bits::consume_truer_,
+        &function_table_parser_bits::consume_trueu_,
+        &function_table_parser_bits::consume_nulln_,
+        &function_table_parser_bits::consume_nullu_,
+        &function_table_parser_bits::consume_nulll_,
+        &function_table_parser_bits::consume_stringkey_,
+        &function_table_parser_bits::consume_string_,
+        &function_table_parser_bits::consume_stringescape_,
+        &function_table_parser_bits::consume_stringuvalue_,
+        &function_table_parser_bits::consume_stringuvalue1_,
+        &function_table_parser_bits::consume_stringuvalue2_,
+        &function_table_parser_bits::consume_stringuvalue3_,
+        &function_table_parser_bits::consume_stringuvalue4_,
+        &function_table_parser_bits::consume_stringuvalue5_,
+        &function_table_parser_bits::consume_stringuvalue6_,
+        &function_table_parser_bits::consume_stringuvalue7_,
+        &function_table_parser_bits::consume_stringuvalue8_,
+        &function_table_parser_bits::consume_stringuvalue9_,
+        &function_table_parser_bits::consume_numberstarting0_,
+        &function_table_parser_bits::consume_number_,
+        &function_table_parser_bits::consume_skipvalue_,
+        &function_table_parser_bits::consume_skip_,
+        &function_table_parser_bits::consume_inerror_
+    };
+    static_assert(sizeof(consumers_) / sizeof(consumer_fn) == static_cast<std::size_t>(State::InError) + 1,
+                  "One consumer is needed for every state");
+
+public:
+    bool consume_(char_type_* c)
+    {
+        return (this->*consumers_[static_cast<std::size_t>(this->state_)])(c);
+    }
+
+    bool consume(char_type_ c)
+    {
+        return consume_(&c) && consume_(nullptr);
+    }
+
+    template<typename char_type_iterator>
+    bool consume(char_type_iterator begin, char_type_iterator end)
+    {
+        bool good = true;
+        while(begin != end && good)
+        {
+            good = consume_(begin);
+            ++begin;
+        }
+        good = good && consume_(nullptr);
+        return good;
+    }
+};
+
 }
 }
 
@@ -0,0 +1,71 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_PARSER_LIMITS_H
+#define JBC_JSON_PARSER_LIMITS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * @brief The parse_error enum tells why parsing failed
+ */
+enum class parse_error : std::uint8_t
+{
+    none = 0 /**< no error */,
+    syntax = 1 /**< invalid document */,
+    handler_failed = 2 /**< a callback rejected the document */,
+    depth_limit = 3 /**< too many nested arrays and objects */,
+    string_length_limit = 4 /**< string or key too long */,
+    number_length_limit = 5 /**< number too long */,
+    element_count_limit = 6 /**< too many values */,
+    dom_size_limit = 7 /**< built item too large */,
+    invalid_utf8 = 8 /**< string or key not valid UTF-8, when validation is enabled */
+};
+
+/**
+ * @brief The parser_limits struct sets resource limits, enforced while parsing so that a hostile document fails
+ * before large allocations are made. 0 means no limit, which is the default for all of them.
+ */
+struct parser_limits
+{
+    std::size_t max_depth = 0; /**< maximum number of nested arrays and objects */
+    std::size_t max_string_length = 0; /**< maximum length of a string or a key, in decoded characters */
+    std::size_t max_number_length = 0; /**< maximum length of a number, in characters */
+    std::size_t max_element_count = 0; /**< maximum number of values inside the top level value */
+    std::size_t max_dom_bytes = 0; /**< maximum size of the built item, approximated by the item builder */
+
+    /**
+     * @brief effective returns the limit to compare with : no limit is the largest value
+     */
+    static constexpr std::size_t effective(std::size_t limit)
+    {
+        return limit == 0 ? std::numeric_limits<std::size_t>::max() : limit;
+    }
+};
+
+/**
+ * @brief has_limits tells whether T provides set_limits(parser_limits const&). Parsers use it to forward the
+ * limits to their callbacks, which must then also provide limit_error(), telling which limit made them fail.
+ */
+template<typename T, typename = void>
+struct has_limits : std::false_type {};
+
+template<typename T>
+struct has_limits<T, std::void_t<decltype(std::declval<T&>().set_limits(std::declval<parser_limits const&>()))> > :
+        std::true_type {};
+
+}
+}
+
+#endif // JBC_JSON_PARSER_LIMITS_H
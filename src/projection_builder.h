@@ -0,0 +1,418 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_PROJECTION_BUILDER_H
+#define JBC_JSON_PROJECTION_BUILDER_H
+
+#include "handler_result.h"
+#include "item_builder.h"
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * The projection class is a set of JSON Pointers (RFC 6901), compiled into a trie : each node is a path
+ * prefix, its children are the next reference tokens. A node is selected when a pointer ends there, which
+ * selects its whole subtree. A projection is built once, and can then be used for any number of documents.
+ */
+class projection
+{
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    projection();
+
+    /**
+     * @brief add adds a pointer to the set. The empty pointer selects the whole document.
+     * @return false if pointer is not a valid JSON Pointer, in which case the set is unchanged
+     */
+    bool add(std::string_view pointer);
+
+    /**
+     * @brief find returns the child of node whose reference token is key, or npos
+     */
+    std::size_t find(std::size_t node, std::string_view key) const;
+    /**
+     * @brief find returns the child of node whose reference token is the array index index, or npos
+     */
+    std::size_t find(std::size_t node, std::size_t index) const;
+    /**
+     * @brief selected tells whether the whole subtree of node is selected. The root node is 0.
+     */
+    bool selected(std::size_t node) const;
+    /**
+     * @brief index_count returns the number of array elements up to the last one that has a child, 0 if none
+     */
+    std::size_t index_count(std::size_t node) const;
+
+private:
+    struct node_data
+    {
+        std::vector<std::pair<std::string, std::size_t> > children;
+        std::size_t index_count = 0;
+        bool selected = false;
+    };
+    std::vector<node_data> nodes_;
+
+    static bool parse_index_(std::string const& token, std::size_t& index);
+};
+
+inline projection::projection() :
+    nodes_(1)
+{
+}
+
+inline bool projection::parse_index_(std::string const& token, std::size_t& index)
+{
+    if(token.empty() || token.size() > 18 || (token[0] == '0' && token.size() > 1)) // no leading zero
+        return false;
+    index = 0;
+    for(char c : token)
+    {
+        if(c < '0' || c > '9')
+            return false;
+        index = index * 10 + static_cast<std::size_t>(c - '0');
+    }
+    return true;
+}
+
+inline bool projection::add(std::string_view pointer)
+{
+    if(!pointer.empty() && pointer[0] != '/')
+        return false;
+    std::vector<std::string> tokens;
+    for(std::size_t pos = 0; pos < pointer.size();)
+    {
+        std::size_t next = pointer.find('/', pos + 1);
+        if(next == std::string_view::npos)
+            next = pointer.size();
+        std::string token;
+        for(std::size_t i = pos + 1; i < next; ++i)
+        {
+            if(pointer[i] != '~')
+                token += pointer[i];
+            else if(i + 1 < next && (pointer[i + 1] == '0' || pointer[i + 1] == '1'))
+                token += pointer[++i] == '0' ? '~' : '/';
+            else
+                return false;
+        }
+        tokens.push_back(std::move(token));
+        pos = next;
+    }
+    std::size_t current = 0;
+    for(std::string& token : tokens)
+    {
+        std::size_t child = find(current, token);
+        if(child == npos)
+        {
+            child = nodes_.size();
+            std::size_t index;
+            if(parse_index_(token, index) && index + 1 > nodes_[current].index_count)
+                nodes_[current].index_count = index + 1;
+            nodes_[current].children.emplace_back(std::move(token), child);
+            nodes_.emplace_back(); // invalidates references to the nodes
+        }
+        current = child;
+    }
+    nodes_[current].selected = true;
+    return true;
+}
+
+inline std::size_t projection::find(std::size_t node, std::string_view key) const
+{
+    for(auto const& child : nodes_[node].children)
+    {
+        if(child.first == key)
+            return child.second;
+    }
+    return npos;
+}
+
+inline std::size_t projection::find(std::size_t node, std::size_t index) const
+{
+    if(index >= nodes_[node].index_count)
+        return npos;
+    return find(node, std::to_string(index));
+}
+
+inline bool projection::selected(std::size_t node) const
+{
+    return nodes_[node].selected;
+}
+
+inline std::size_t projection::index_count(std::size_t node) const
+{
+    return nodes_[node].index_count;
+}
+
+/**
+ * The projection_builder class builds only the parts of the document selected by a projection, and their
+ * ancestors. Keys that are not on a selected path are skipped by the parser, with their values, without any
+ * handler call. In arrays that are on a selected path, the elements before the last selected index are kept
+ * as null, so that selected elements keep their index, and the following ones are dropped. A scalar found
+ * where a path expects an array or an object is kept.
+ *
+ * Keys are compared as std::string_view. Without a projection, the whole document is built.
+ */
+template<template<class> class container, typename Item_>
+class projection_builder : public item_builder<container, Item_>
+{
+    using base = item_builder<container, Item_>;
+    using string_view = typename Item_::traits::string_view;
+
+    /**
+     * @brief The frame struct is an array or an object on a selected path, whose children are filtered
+     */
+    struct frame
+    {
+        std::size_t node;
+        std::size_t next_index;
+        bool object;
+    };
+
+    projection const* projection_ = nullptr;
+    container<frame> frames_;
+    std::size_t selected_depth_ = 0; // number of open containers inside a selected subtree
+    std::size_t pending_node_ = projection::npos; // node of the value of the last key
+    bool discard_string_ = false;
+
+    /**
+     * @brief enter_value_ finds the node of the value that begins, when outside a selected subtree
+     * @return skip if the value is not selected
+     */
+    handler_result enter_value_(std::size_t& node);
+    /**
+     * @brief scalar_ tells whether a scalar value must be built
+     */
+    handler_result scalar_();
+    handler_result begin_container_(bool object);
+    void end_container_();
+
+protected:
+    // ARRAY
+    handler_result begin_array_handler();
+    bool end_array_handler();
+
+    // OBJECT
+    handler_result begin_object_handler();
+    bool end_object_handler();
+
+    // SCALARS
+    bool boolean_handler(bool value);
+    bool double_handler(double value);
+#ifdef JSON_USE_LONG_INTEGERS
+    bool integer_handler(int64_t value);
+#endif
+    bool null_handler();
+
+    // STRING
+    bool begin_string_handler();
+    bool string_content_handler(string_view value);
+    bool end_string_handler();
+
+    // KEY
+    handler_result end_key_handler();
+
+public:
+    /**
+     * @brief set_projection sets the paths to build. The projection must outlive the builder, or the next call
+     * to set_projection.
+     */
+    void set_projection(projection const* p);
+
+    /**
+     * @brief reset discards the item being built. The projection is kept.
+     */
+    void reset();
+};
+
+template<template<class> class container,typename Item_>
+void projection_builder<container, Item_>::set_projection(projection const* p)
+{
+    projection_ = p;
+}
+
+template<template<class> class container,typename Item_>
+void projection_builder<container, Item_>::reset()
+{
+    base::reset();
+    frames_.clear();
+    selected_depth_ = 0;
+    pending_node_ = projection::npos;
+    discard_string_ = false;
+}
+
+template<template<class> class container,typename Item_>
+handler_result projection_builder<container, Item_>::enter_value_(std::size_t& node)
+{
+    if(frames_.empty()) // top level value
+    {
+        node = 0;
+        return handler_result::proceed;
+    }
+    frame& f = frames_.back();
+    if(f.object)
+    {
+        node = pending_node_;
+        return handler_result::proceed;
+    }
+    std::size_t const index = f.next_index++;
+    node = projection_->find(f.node, index);
+    if(node != projection::npos)
+        return handler_result::proceed;
+    if(index < projection_->index_count(f.node)) // keep the index of the next selected elements
+        return base::null_handler() ? handler_result::skip : handler_result::fail;
+    return handler_result::skip;
+}
+
+template<template<class> class container,typename Item_>
+handler_result projection_builder<container, Item_>::scalar_()
+{
+    if(selected_depth_ > 0)
+        return handler_result::proceed;
+    std::size_t node;
+    return enter_value_(node);
+}
+
+template<template<class> class container,typename Item_>
+handler_result projection_builder<container, Item_>::begin_container_(bool object)
+{
+    if(selected_depth_ == 0)
+    {
+        std::size_t node = 0;
+        handler_result result = enter_value_(node);
+        if(result != handler_result::proceed)
+            return result;
+        if(projection_ != nullptr && !projection_->selected(node))
+        {
+            frames_.push_back(frame{node, 0, object});
+            return handler_result::proceed;
+        }
+    }
+    ++selected_depth_;
+    return handler_result::proceed;
+}
+
+template<template<class> class container,typename Item_>
+void projection_builder<container, Item_>::end_container_()
+{
+    if(selected_depth_ > 0)
+        --selected_depth_;
+    else
+        frames_.pop_back();
+}
+
+template<template<class> class container,typename Item_>
+handler_result projection_builder<container, Item_>::begin_array_handler()
+{
+    handler_result result = begin_container_(false);
+    if(result != handler_result::proceed)
+        return result;
+    return to_handler_result(base::begin_array_handler());
+}
+
+template<template<class> class container,typename Item_>
+bool projection_builder<container, Item_>::end_array_handler()
+{
+    end_container_();
+    return base::end_array_handler();
+}
+
+template<template<class> class container,typename Item_>
+handler_result projection_builder<container, Item_>::begin_object_handler()
+{
+    handler_result result = begin_container_(true);
+    if(result != handler_result::proceed)
+        return result;
+    return to_handler_result(base::begin_object_handler());
+}
+
+template<template<class> class container,typename Item_>
+bool projection_builder<container, Item_>::end_object_handler()
+{
+    end_container_();
+    return base::end_object_handler();
+}
+
+template<template<class> class container,typename Item_>
+bool projection_builder<container, Item_>::boolean_handler(bool value)
+{
+    handler_result result = scalar_();
+    return result == handler_result::skip || (result == handler_result::proceed && base::boolean_handler(value));
+}
+
+template<template<class> class container,typename Item_>
+bool projection_builder<container, Item_>::double_handler(double value)
+{
+    handler_result result = scalar_();
+    return result == handler_result::skip || (result == handler_result::proceed && base::double_handler(value));
+}
+
+#ifdef JSON_USE_LONG_INTEGERS
+template<template<class> class container,typename Item_>
+bool projection_builder<container, Item_>::integer_handler(int64_t value)
+{
+    handler_result result = scalar_();
+    return result == handler_result::skip || (result == handler_result::proceed && base::integer_handler(value));
+}
+#endif
+
+template<template<class> class container,typename Item_>
+bool projection_builder<container, Item_>::null_handler()
+{
+    handler_result result = scalar_();
+    return result == handler_result::skip || (result == handler_result::proceed && base::null_handler());
+}
+
+template<template<class> class container,typename Item_>
+bool projection_builder<container, Item_>::begin_string_handler()
+{
+    handler_result result = scalar_();
+    discard_string_ = result == handler_result::skip;
+    return result == handler_result::skip || (result == handler_result::proceed && base::begin_string_handler());
+}
+
+template<template<class> class container,typename Item_>
+bool projection_builder<container, Item_>::string_content_handler(string_view value)
+{
+    return discard_string_ || base::string_content_handler(value);
+}
+
+template<template<class> class container,typename Item_>
+bool projection_builder<container, Item_>::end_string_handler()
+{
+    if(discard_string_)
+    {
+        discard_string_ = false;
+        return true;
+    }
+    return base::end_string_handler();
+}
+
+template<template<class> class container,typename Item_>
+handler_result projection_builder<container, Item_>::end_key_handler()
+{
+    if(selected_depth_ == 0)
+    {
+        pending_node_ = projection_->find(frames_.back().node, std::string_view(base::lastString_));
+        if(pending_node_ == projection::npos)
+        {
+            base::lastString_.clear();
+            return handler_result::skip;
+        }
+    }
+    return to_handler_result(base::end_key_handler());
+}
+
+}
+}
+
+#endif // JBC_JSON_PROJECTION_BUILDER_H
@@ -0,0 +1,264 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_PULL_READER_H
+#define JBC_JSON_PULL_READER_H
+
+#include "stl_json.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * @brief The pull_event enum lists what pull_reader::next can return
+ */
+enum class pull_event : std::uint8_t
+{
+    need_more_input, /**< every event of the input fed so far was read */
+    begin_array,
+    end_array,
+    begin_object,
+    end_object,
+    key,
+    string,
+    number,
+    integer, /**< only with JSON_USE_LONG_INTEGERS, numbers are reported as number otherwise */
+    boolean,
+    null,
+    end_of_document,
+    error
+};
+
+/**
+ * @brief The pull_token struct is an event returned by pull_reader::next, with its value
+ */
+struct pull_token
+{
+    pull_event type = pull_event::need_more_input;
+    std::string_view text; /**< for keys and strings, valid until the next call to feed or reset */
+    double number = 0;
+    std::int64_t integer = 0;
+    bool boolean = false;
+};
+
+namespace pull_reader_detail
+{
+
+/**
+ * @brief The recorder struct is the callbacks policy of the pull reader : it records the events of the input
+ * fed, and the contents of strings and keys, which can be split across buffers
+ */
+struct recorder
+{
+    struct record
+    {
+        pull_event type;
+        bool boolean;
+        std::size_t offset; /**< offset of the text of strings and keys */
+        std::size_t size;
+        double number;
+        std::int64_t integer;
+    };
+
+    std::vector<record> records;
+    std::vector<char> text;
+    std::size_t string_start = 0;
+    bool string_open = false;
+
+    bool push(pull_event type)
+    {
+        records.push_back(record{type, false, 0, 0, 0., 0});
+        return true;
+    }
+    bool start_string()
+    {
+        string_start = text.size();
+        string_open = true;
+        return true;
+    }
+    bool end_string(pull_event type)
+    {
+        records.push_back(record{type, false, string_start, text.size() - string_start, 0., 0});
+        string_open = false;
+        return true;
+    }
+    bool content(std::string_view value)
+    {
+        text.insert(text.end(), value.begin(), value.end());
+        return true;
+    }
+    /**
+     * @brief discard_read drops the records, and the text except the string being read
+     */
+    void discard_read()
+    {
+        records.clear();
+        std::size_t const keep = string_open ? string_start : text.size();
+        text.erase(text.begin(), text.begin() + static_cast<std::ptrdiff_t>(keep));
+        string_start = 0;
+    }
+    void reset()
+    {
+        records.clear();
+        text.clear();
+        string_start = 0;
+        string_open = false;
+    }
+
+    // ARRAY
+    bool begin_array_handler() { return push(pull_event::begin_array); }
+    bool end_array_handler() { return push(pull_event::end_array); }
+
+    // OBJECT
+    bool begin_object_handler() { return push(pull_event::begin_object); }
+    bool end_object_handler() { return push(pull_event::end_object); }
+
+    // SCALARS
+    bool boolean_handler(bool value)
+    {
+        push(pull_event::boolean);
+        records.back().boolean = value;
+        return true;
+    }
+    bool double_handler(double value)
+    {
+        push(pull_event::number);
+        records.back().number = value;
+        return true;
+    }
+#ifdef JSON_USE_LONG_INTEGERS
+    bool integer_handler(int64_t value)
+    {
+        push(pull_event::integer);
+        records.back().integer = value;
+        return true;
+    }
+#endif
+    bool null_handler() { return push(pull_event::null); }
+
+    // STRING
+    bool begin_string_handler() { return start_string(); }
+    bool string_content_handler(std::string_view value) { return content(value); }
+    bool end_string_handler() { return end_string(pull_event::string); }
+
+    // KEY
+    bool begin_key_handler() { return start_string(); }
+    bool key_content_handler(std::string_view value) { return content(value); }
+    bool end_key_handler() { return end_string(pull_event::key); }
+};
+
+}
+
+/**
+ * The pull_reader class reads a document as a sequence of events, pulled one by one with next(), instead of
+ * callbacks. The input is given in buffers of any size to feed(), which runs the incremental parser on them :
+ * once their events are read, next() returns need_more_input, and the next buffer can be fed. This lets code
+ * that receives the document in parts, such as coroutines, consume it without a DOM or a callback state machine.
+ *
+ * The events of a buffer are recorded when it is fed, so the buffer can be reused as soon as feed returns. Strings
+ * and keys are reported whole, even when split across buffers. The events found before an error are returned
+ * first, then error.
+ */
+class pull_reader
+{
+public:
+    /**
+     * @brief feed parses the characters in [begin, end)
+     * @return false if the document is invalid
+     */
+    bool feed(char* begin, char* end);
+
+    /**
+     * @brief finish tells that there is no more input : next() then returns error instead of need_more_input if
+     * the document is incomplete
+     * @return false if the document is invalid or incomplete
+     */
+    bool finish();
+
+    /**
+     * @brief next returns the next event
+     */
+    pull_token next();
+
+    /**
+     * @brief reset discards the document, so that another one can be read
+     */
+    void reset();
+
+    /**
+     * @brief error_message returns the error message of the parser, nullptr if there is no error
+     */
+    char const* error_message() const;
+
+    /**
+     * @brief error_offset returns the offset in the document of the character at which the error was detected
+     */
+    std::size_t error_offset() const;
+
+private:
+    using parser_type = parser_bits<stdvector, pull_reader_detail::recorder, std::vector<char>, char>;
+    parser_type parser_;
+    std::size_t next_ = 0;
+};
+
+inline bool pull_reader::feed(char* begin, char* end)
+{
+    if(next_ == parser_.records.size())
+    {
+        parser_.discard_read();
+        next_ = 0;
+    }
+    return parser_.consume(begin, end);
+}
+
+inline bool pull_reader::finish()
+{
+    return parser_.end();
+}
+
+inline pull_token pull_reader::next()
+{
+    pull_token token;
+    if(next_ < parser_.records.size())
+    {
+        pull_reader_detail::recorder::record const& r = parser_.records[next_++];
+        token.type = r.type;
+        token.text = std::string_view(parser_.text.data() + r.offset, r.size);
+        token.number = r.number;
+        token.integer = r.integer;
+        token.boolean = r.boolean;
+    }
+    else if(parser_.error_message() != nullptr)
+        token.type = pull_event::error;
+    else if(parser_.complete_without_error())
+        token.type = pull_event::end_of_document;
+    return token;
+}
+
+inline void pull_reader::reset()
+{
+    parser_.reset();
+    next_ = 0;
+}
+
+inline char const* pull_reader::error_message() const
+{
+    return parser_.error_message();
+}
+
+inline std::size_t pull_reader::error_offset() const
+{
+    return parser_.error_offset();
+}
+
+}
+}
+
+#endif // JBC_JSON_PULL_READER_H
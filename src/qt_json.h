@@ -121,18 +121,33 @@ struct helper_functions<QVector<QChar>, QChar>
             return -1;
     }
 
-    static std::pair<bool, int64_t> string_to_integer(QString const& ref)
+    static std::pair<bool, int64_t> string_to_integer(QVector<QChar> const& ref)
     {
-        std::pair<bool, int64_t> result;
-        result.second = ref.toLongLong(&result.first);
-        return result;
+        return chars_to_integer(ref.data(), ref.data() + ref.size());
     }
-    static QPair<bool, double> string_to_double(QVector<QChar> const& ref)
+    static std::pair<bool, double> string_to_double(QVector<QChar> const& ref)
     {
-        QPair<bool, double> result;
-        QString s(ref.data(), ref.size());
-        result.second = s.toDouble(&result.first);
-        return result;
+        return chars_to_double(ref.data(), ref.data() + ref.size());
+    }
+    static std::pair<bool, int64_t> chars_to_integer(QChar const* first, QChar const* last)
+    {
+        char buf[64];
+        if(last - first > static_cast<std::ptrdiff_t>(sizeof(buf)))
+            return {false, 0};
+        qt_types::copy_basic_data(first, last, buf);
+        return helper_functions<std::string, char>::chars_to_integer(buf, buf + (last - first));
+    }
+    static std::pair<bool, double> chars_to_double(QChar const* first, QChar const* last)
+    {
+        char buf[64];
+        if(last - first > static_cast<std::ptrdiff_t>(sizeof(buf)))
+        {
+            std::string s(static_cast<std::size_t>(last - first), '0');
+            qt_types::copy_basic_data(first, last, &s.front());
+            return helper_functions<std::string, char>::chars_to_double(s.data(), s.data() + s.size());
+        }
+        qt_types::copy_basic_data(first, last, buf);
+        return helper_functions<std::string, char>::chars_to_double(buf, buf + (last - first));
     }
     static QString make_string_view(QChar const* data, int size)
     {
@@ -0,0 +1,252 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_READ_PIPELINE_H
+#define JBC_JSON_READ_PIPELINE_H
+
+#include "stl_json.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * @brief The pipeline_options struct sets the ring of buffers used by a read_pipeline
+ */
+struct pipeline_options
+{
+    std::size_t buffer_count = 4;
+    std::size_t buffer_size = 65536;
+};
+
+/**
+ * @brief The pipeline_statistics struct tells where a read_pipeline waited. Reader stalls mean that parsing is
+ * the bottleneck, parser stalls mean that reading is.
+ */
+struct pipeline_statistics
+{
+    std::size_t blocks = 0; /**< number of blocks read */
+    std::size_t bytes = 0; /**< number of bytes read */
+    std::size_t reader_stalls = 0; /**< number of times the reader waited for a free buffer */
+    std::size_t parser_stalls = 0; /**< number of times the parser waited for a filled buffer */
+    std::chrono::nanoseconds reader_stall_time{0};
+    std::chrono::nanoseconds parser_stall_time{0};
+};
+
+/**
+ * The read_pipeline class reads its input on a dedicated thread, into a ring of buffers, while the calling thread
+ * parses the blocks already read. Reading latency then overlaps with parsing, which matters for slow sources such
+ * as pipes or network file systems.
+ *
+ * The read function is only called from the reader thread. It must fill the given buffer, and return the number
+ * of characters read, 0 at the end of the input. The destructor waits for the read in progress, if any.
+ */
+class read_pipeline
+{
+public:
+    using read_function = std::function<std::size_t(char* buffer, std::size_t size)>;
+
+    explicit read_pipeline(read_function read, pipeline_options const& options = pipeline_options());
+    read_pipeline(read_pipeline const&) = delete;
+    read_pipeline& operator=(read_pipeline const&) = delete;
+    ~read_pipeline();
+
+    /**
+     * @brief next gives the previous block back to the reader, and returns the next one, waiting for it if needed
+     * @return begin and end of the block, both null at the end of the input
+     */
+    std::pair<char*, char*> next();
+
+    /**
+     * @brief statistics returns the statistics so far
+     */
+    pipeline_statistics statistics() const;
+
+private:
+    void reader_();
+
+    read_function read_;
+    std::vector<std::vector<char> > buffers_;
+    std::vector<std::size_t> sizes_;
+    std::size_t written_ = 0; // number of blocks filled by the reader
+    std::size_t taken_ = 0; // number of blocks given to the parser
+    std::size_t released_ = 0; // number of blocks given back by the parser
+    bool eof_ = false;
+    bool stopping_ = false;
+    pipeline_statistics statistics_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable buffer_free_;
+    std::condition_variable buffer_filled_;
+    std::thread reader_thread_;
+};
+
+inline read_pipeline::read_pipeline(read_function read, pipeline_options const& options) :
+    read_(std::move(read)),
+    buffers_(std::max<std::size_t>(options.buffer_count, 2), std::vector<char>(std::max<std::size_t>(options.buffer_size, 1))),
+    sizes_(buffers_.size(), 0)
+{
+    reader_thread_ = std::thread(&read_pipeline::reader_, this);
+}
+
+inline read_pipeline::~read_pipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    buffer_free_.notify_all();
+    reader_thread_.join();
+}
+
+inline void read_pipeline::reader_()
+{
+    for(;;)
+    {
+        std::size_t block;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if(!stopping_ && written_ - released_ == buffers_.size())
+            {
+                auto start = std::chrono::steady_clock::now();
+                buffer_free_.wait(lock, [this]() { return stopping_ || written_ - released_ < buffers_.size(); });
+                ++statistics_.reader_stalls;
+                statistics_.reader_stall_time += std::chrono::steady_clock::now() - start;
+            }
+            if(stopping_)
+                return;
+            block = written_ % buffers_.size();
+        }
+        std::size_t size = read_(buffers_[block].data(), buffers_[block].size());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(size == 0)
+                eof_ = true;
+            else
+            {
+                sizes_[block] = size;
+                ++written_;
+                ++statistics_.blocks;
+                statistics_.bytes += size;
+            }
+        }
+        buffer_filled_.notify_one();
+        if(size == 0)
+            return;
+    }
+}
+
+inline std::pair<char*, char*> read_pipeline::next()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(released_ < taken_)
+    {
+        ++released_;
+        buffer_free_.notify_one();
+    }
+    if(written_ == taken_ && !eof_)
+    {
+        auto start = std::chrono::steady_clock::now();
+        buffer_filled_.wait(lock, [this]() { return written_ > taken_ || eof_; });
+        ++statistics_.parser_stalls;
+        statistics_.parser_stall_time += std::chrono::steady_clock::now() - start;
+    }
+    if(written_ == taken_)
+        return {nullptr, nullptr};
+    std::size_t block = taken_ % buffers_.size();
+    ++taken_;
+    return {buffers_[block].data(), buffers_[block].data() + sizes_[block]};
+}
+
+inline pipeline_statistics read_pipeline::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+namespace read_pipeline_detail
+{
+
+/**
+ * @brief parse_blocks parses everything given by the pipeline
+ */
+inline bool parse_blocks(read_pipeline& pipeline, stl_item& destination, pipeline_statistics* statistics)
+{
+    stl_parser& parser = stl_json_detail::thread_local_parser<stl_parser>();
+    bool good = true;
+    for(auto block = pipeline.next(); good && block.first != nullptr; block = pipeline.next())
+        good = parser.consume(block.first, block.second);
+    good = good && parser.end();
+    if(statistics != nullptr)
+        *statistics = pipeline.statistics();
+    if(good)
+        parser.moveTo(destination);
+    return good;
+}
+
+}
+
+/**
+ * @brief parse_from_stream_pipelined is parse_from_stream, with the stream read by a reader thread while the
+ * calling thread parses
+ * @param statistics if not null, receives the pipeline statistics
+ */
+template<typename stream>
+inline bool parse_from_stream_pipelined(stream& f, stl_item& destination, pipeline_options const& options = pipeline_options(),
+                                        pipeline_statistics* statistics = nullptr)
+{
+    if(!f.good())
+        return false;
+    bool good = false;
+    {
+        read_pipeline pipeline([&f](char* buffer, std::size_t size) -> std::size_t {
+            if(!f.good())
+                return 0;
+            return static_cast<std::size_t>(f.read(buffer, static_cast<std::streamsize>(size)).gcount());
+        }, options);
+        good = read_pipeline_detail::parse_blocks(pipeline, destination, statistics);
+    }
+    return good && f.eof();
+}
+
+/**
+ * @brief parse_from_file_pipelined reads the file on a reader thread while the calling thread parses. Unlike
+ * parse_from_file, the file is never mapped, which suits pipes and slow network file systems.
+ * @param statistics if not null, receives the pipeline statistics
+ */
+inline bool parse_from_file_pipelined(std::string const& file, stl_item& destination, pipeline_options const& options = pipeline_options(),
+                                      pipeline_statistics* statistics = nullptr)
+{
+    FILE* f = fopen(file.c_str(), "rb");
+    if(!f)
+        return false;
+    bool good = false;
+    bool read_error = false;
+    {
+        read_pipeline pipeline([f, &read_error](char* buffer, std::size_t size) -> std::size_t {
+            std::size_t ret = fread(buffer, sizeof(char), size, f);
+            if(ret == 0 && ferror(f))
+                read_error = true;
+            return ret;
+        }, options);
+        good = read_pipeline_detail::parse_blocks(pipeline, destination, statistics);
+    }
+    fclose(f);
+    return good && !read_error;
+}
+
+}
+}
+
+#endif // JBC_JSON_READ_PIPELINE_H
@@ -0,0 +1,286 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_SCAN_HELPERS_H
+#define JBC_JSON_SCAN_HELPERS_H
+
+#include <cstdint>
+#include <type_traits>
+#include "helper_functions.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * @brief returns the number of trailing zero bits of a non null mask
+ */
+inline unsigned int trailing_zeros(std::uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return static_cast<unsigned int>(idx);
+#else
+    return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+
+/**
+ * @brief returns the number of trailing zero bits of a non null 64 bits mask
+ */
+inline unsigned int trailing_zeros64(std::uint64_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, mask);
+    return static_cast<unsigned int>(idx);
+#else
+    return static_cast<unsigned int>(__builtin_ctzll(mask));
+#endif
+}
+
+/**
+ * @brief The scan_helper struct provides bulk scanning functions, used by the parser to skip
+ * over runs of characters that do not need to go through the state machine one by one.
+ * Single byte characters use SSE2 / AVX2 when available, other character types (or targets without
+ * simd support) use a portable loop built on token_helper.
+ */
+template<typename char_type>
+struct scan_helper
+{
+    /**
+     * @brief find_string_special returns a pointer to the first character in [begin, end) that
+     * cannot be part of a plain string run : double quote, backslash or control character.
+     * @return end if no such character is found
+     */
+    static char_type* find_string_special(char_type* begin, char_type* end);
+    /**
+     * @brief find_string_special also tells whether the characters before the one found are all ascii, for free
+     * since each block is already loaded. Used to skip UTF-8 validation of ascii runs.
+     * @param non_ascii set to true if a character before the one returned is not ascii, unchanged otherwise
+     */
+    static char_type* find_string_special(char_type* begin, char_type* end, bool& non_ascii);
+
+    /**
+     * @brief skip_whitespace returns a pointer to the first character in [begin, end) that is not
+     * a json whitespace (space, tab, line feed or carriage return).
+     * @return end if only whitespace is found
+     */
+    static char_type* skip_whitespace(char_type* begin, char_type* end);
+
+    /**
+     * @brief find_bracket_or_quote returns a pointer to the first character in [begin, end) that is a bracket,
+     * a curly bracket or a double quote. Used to skip over arrays and objects.
+     * @return end if no such character is found
+     */
+    static char_type* find_bracket_or_quote(char_type* begin, char_type* end);
+
+private:
+    template<bool track_non_ascii>
+    static char_type* find_string_special_(char_type* begin, char_type* end, bool& non_ascii);
+};
+
+template<typename char_type>
+char_type* scan_helper<char_type>::find_string_special(char_type* begin, char_type* end)
+{
+    bool non_ascii = false;
+    return find_string_special_<false>(begin, end, non_ascii);
+}
+
+template<typename char_type>
+char_type* scan_helper<char_type>::find_string_special(char_type* begin, char_type* end, bool& non_ascii)
+{
+    return find_string_special_<true>(begin, end, non_ascii);
+}
+
+template<typename char_type>
+template<bool track_non_ascii>
+char_type* scan_helper<char_type>::find_string_special_(char_type* begin, char_type* end, bool& non_ascii)
+{
+    char_type* cur = begin;
+    std::uint32_t high = 0; // high bits of the bytes before the special character
+    if constexpr(sizeof(char_type) == 1 && std::is_integral_v<char_type>)
+    {
+#if defined(__AVX2__)
+        __m256i const quote32 = _mm256_set1_epi8('"');
+        __m256i const backslash32 = _mm256_set1_epi8('\\');
+        __m256i const control32 = _mm256_set1_epi8(0x1F);
+        while(end - cur >= 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(cur));
+            __m256i special = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, backslash32)),
+                        _mm256_cmpeq_epi8(_mm256_min_epu8(v, control32), v)); // unsigned v <= 0x1F
+            std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(special));
+            if constexpr(track_non_ascii) // only the bytes before the first special one
+                high |= static_cast<std::uint32_t>(_mm256_movemask_epi8(v)) & (mask != 0 ? (mask & (0u - mask)) - 1 : ~0u);
+            if(mask != 0)
+            {
+                if(high != 0)
+                    non_ascii = true;
+                return cur + trailing_zeros(mask);
+            }
+            cur += 32;
+        }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        __m128i const quote = _mm_set1_epi8('"');
+        __m128i const backslash = _mm_set1_epi8('\\');
+        __m128i const control = _mm_set1_epi8(0x1F);
+        while(end - cur >= 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(cur));
+            __m128i special = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                        _mm_cmpeq_epi8(_mm_min_epu8(v, control), v)); // unsigned v <= 0x1F
+            std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(special));
+            if constexpr(track_non_ascii)
+                high |= static_cast<std::uint32_t>(_mm_movemask_epi8(v)) & (mask != 0 ? (mask & (0u - mask)) - 1 : ~0u);
+            if(mask != 0)
+            {
+                if(high != 0)
+                    non_ascii = true;
+                return cur + trailing_zeros(mask);
+            }
+            cur += 16;
+        }
+#endif
+    }
+    for(; cur != end; ++cur)
+    {
+        if(token_helper<char_type>::is_token_double_quote(*cur) ||
+                token_helper<char_type>::is_token_backslash(*cur) ||
+                token_helper<char_type>::is_token_forbidden_in_string(*cur))
+            break;
+        if constexpr(track_non_ascii)
+            high |= static_cast<unsigned char>(*cur) & 0x80u;
+    }
+    if(high != 0)
+        non_ascii = true;
+    return cur;
+}
+
+template<typename char_type>
+char_type* scan_helper<char_type>::skip_whitespace(char_type* begin, char_type* end)
+{
+    char_type* cur = begin;
+    if constexpr(sizeof(char_type) == 1 && std::is_integral_v<char_type>)
+    {
+#if defined(__AVX2__)
+        __m256i const space32 = _mm256_set1_epi8(' ');
+        __m256i const tab32 = _mm256_set1_epi8('\t');
+        __m256i const lf32 = _mm256_set1_epi8('\n');
+        __m256i const cr32 = _mm256_set1_epi8('\r');
+        while(end - cur >= 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(cur));
+            __m256i ws = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, space32), _mm256_cmpeq_epi8(v, tab32)),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, lf32), _mm256_cmpeq_epi8(v, cr32)));
+            std::uint32_t mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(ws));
+            if(mask != 0)
+                return cur + trailing_zeros(mask);
+            cur += 32;
+        }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        __m128i const space = _mm_set1_epi8(' ');
+        __m128i const tab = _mm_set1_epi8('\t');
+        __m128i const lf = _mm_set1_epi8('\n');
+        __m128i const cr = _mm_set1_epi8('\r');
+        while(end - cur >= 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(cur));
+            __m128i ws = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                        _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+            std::uint32_t mask = ~static_cast<std::uint32_t>(_mm_movemask_epi8(ws)) & 0xFFFFu;
+            if(mask != 0)
+                return cur + trailing_zeros(mask);
+            cur += 16;
+        }
+#endif
+    }
+    for(; cur != end; ++cur)
+    {
+        if(!token_helper<char_type>::is_token_space(*cur))
+            return cur;
+    }
+    return end;
+}
+
+template<typename char_type>
+char_type* scan_helper<char_type>::find_bracket_or_quote(char_type* begin, char_type* end)
+{
+    char_type* cur = begin;
+    if constexpr(sizeof(char_type) == 1 && std::is_integral_v<char_type>)
+    {
+#if defined(__AVX2__)
+        __m256i const quote32 = _mm256_set1_epi8('"');
+        __m256i const bracket32 = _mm256_set1_epi8('[');
+        __m256i const closing_bracket32 = _mm256_set1_epi8(']');
+        __m256i const curly32 = _mm256_set1_epi8('{');
+        __m256i const closing_curly32 = _mm256_set1_epi8('}');
+        while(end - cur >= 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(cur));
+            __m256i special = _mm256_or_si256(
+                        _mm256_cmpeq_epi8(v, quote32),
+                        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, bracket32), _mm256_cmpeq_epi8(v, closing_bracket32)),
+                                        _mm256_or_si256(_mm256_cmpeq_epi8(v, curly32), _mm256_cmpeq_epi8(v, closing_curly32))));
+            std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(special));
+            if(mask != 0)
+                return cur + trailing_zeros(mask);
+            cur += 32;
+        }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        __m128i const quote = _mm_set1_epi8('"');
+        __m128i const bracket = _mm_set1_epi8('[');
+        __m128i const closing_bracket = _mm_set1_epi8(']');
+        __m128i const curly = _mm_set1_epi8('{');
+        __m128i const closing_curly = _mm_set1_epi8('}');
+        while(end - cur >= 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(cur));
+            __m128i special = _mm_or_si128(
+                        _mm_cmpeq_epi8(v, quote),
+                        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, bracket), _mm_cmpeq_epi8(v, closing_bracket)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v, curly), _mm_cmpeq_epi8(v, closing_curly))));
+            std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(special));
+            if(mask != 0)
+                return cur + trailing_zeros(mask);
+            cur += 16;
+        }
+#endif
+    }
+    for(; cur != end; ++cur)
+    {
+        if(token_helper<char_type>::is_token_double_quote(*cur) ||
+                token_helper<char_type>::is_token_opening_square_bracket(*cur) ||
+                token_helper<char_type>::is_token_closing_square_bracket(*cur) ||
+                token_helper<char_type>::is_token_opening_curly_bracket(*cur) ||
+                token_helper<char_type>::is_token_closing_curly_bracket(*cur))
+            return cur;
+    }
+    return end;
+}
+
+}
+}
+
+#endif // JBC_JSON_SCAN_HELPERS_H
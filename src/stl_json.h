@@ -7,6 +7,11 @@
 #define JBC_JSON_STL_JSON_H
 
 #include "libjson.h"
+#include "mapped_file.h"
+#include "structural_parser.h"
+#include "view_item_builder.h"
+#include "projection_builder.h"
+#include "struct_binding.h"
 #include <vector>
 
 namespace jbc
@@ -54,14 +59,100 @@ struct stl_types
     static void copy_basic_data(char const* first, char const* last, char * dest);
 };
 
+/**
+ * @brief The stl_view_types struct is the same as stl_types, except that strings and keys are std::string_view,
+ * pointing into the parsed buffer. Used with in situ parsing, see parse_in_situ
+ */
+struct stl_view_types : stl_types
+{
+    using string_type = std::string_view;
+    using array_type = std::vector<basic_item<stl_view_types> >;
+    using object_type = std::vector<std::pair<std::string_view, basic_item<stl_view_types> > >;
+    using array_iterator = array_type::iterator;
+    using object_iterator = object_type::iterator;
+    using array_const_iterator = array_type::const_iterator;
+    using object_const_iterator = object_type::const_iterator;
+    template<typename... args>
+    static void array_emplace_back(array_type& container, args... arg)
+    {
+        container.emplace_back(std::forward<args>(arg)...);
+    }
+    template<typename... args>
+    static void object_emplace_back(object_type& container, args&&... arg)
+    {
+        container.emplace_back(std::forward<args>(arg)...);
+    }
+    static std::string_view make_string(char const* str)
+    {
+        return std::string_view(str);
+    }
+};
+
 using stl_item=basic_item<stl_types>;
 using stl_item_builder = item_builder<stdvector, stl_item>;
 using stl_parser = parser_bits<stdvector,stl_item_builder, std::vector<char>,char>;
+using stl_structural_parser = structural_parser<stdvector,stl_item_builder, std::vector<char>,char>;
+using stl_view_item = basic_item<stl_view_types>;
+using stl_view_item_builder = view_item_builder<stdvector, stl_view_item>;
+using stl_in_situ_parser = parser_bits<stdvector, stl_view_item_builder, std::vector<char>, char>;
+using stl_projection_builder = projection_builder<stdvector, stl_item>;
+using stl_projection_parser = parser_bits<stdvector, stl_projection_builder, std::vector<char>, char>;
 //using stl_printer = printer<stl_item>;
 
-inline bool parse_from_file(std::string const& file, stl_item& destination)
+namespace stl_json_detail
 {
-    stl_parser parser;
+
+/**
+ * @brief restore_defaults puts back the settings that reset keeps : limits, in situ parsing and UTF-8 validation
+ */
+template<template<class> class container, typename parser_callbacks, typename buffer_type, typename char_type>
+void restore_defaults(parser_bits<container, parser_callbacks, buffer_type, char_type>& parser)
+{
+    parser.set_limits(parser_limits{});
+    parser.set_in_situ(false);
+    parser.set_utf8_validation(false);
+}
+
+template<typename parser_type>
+void restore_defaults(parser_type&)
+{
+}
+
+/**
+ * @brief thread_local_parser returns a parser owned by the calling thread, reset and with its default settings,
+ * ready for a new document. The parse_* helpers use it, so that the parser stacks and buffers keep their capacity
+ * from one document to the next instead of being allocated again.
+ */
+template<typename parser_type>
+inline parser_type& thread_local_parser()
+{
+    thread_local parser_type parser;
+    parser.reset();
+    restore_defaults(parser);
+    return parser;
+}
+
+}
+
+/**
+ * @brief parse_from_file parses a whole file. Regular files are memory mapped and parsed in a single pass, without
+ * any copy, so that every string is given to the item builder as a single view over the mapping. Other files, such
+ * as pipes, are read by blocks.
+ * @param huge_pages asks for transparent huge pages for the mapping, where supported
+ */
+inline bool parse_from_file(std::string const& file, stl_item& destination, bool huge_pages = false)
+{
+    stl_parser& parser = stl_json_detail::thread_local_parser<stl_parser>();
+    mapped_file mapping(file, huge_pages);
+    if(mapping.is_open())
+    {
+        if(parser.consume(mapping.begin(), mapping.end()) && parser.end())
+        {
+            parser.moveTo(destination);
+            return true;
+        }
+        return false;
+    }
     constexpr const int buffersize = 65536;
     char buf[buffersize];
     bool good = true;
@@ -86,10 +177,73 @@ inline bool parse_from_file(std::string const& file, stl_item& destination)
     }
     return false;
 }
+/**
+ * @brief parse_from_buffer parses a document that is entirely in memory, using the two stages
+ * structural parser
+ */
+inline bool parse_from_buffer(char* begin, char* end, stl_item& destination)
+{
+    stl_structural_parser& parser = stl_json_detail::thread_local_parser<stl_structural_parser>();
+    if(!parser.parse(begin, end))
+        return false;
+    parser.moveTo(destination);
+    return true;
+}
+
+/**
+ * @brief parse_in_situ parses a document that is entirely in memory, decoding escape sequences in place. The
+ * buffer is modified, and the strings and keys of destination point into it : it must outlive destination.
+ */
+inline bool parse_in_situ(char* begin, char* end, stl_view_item& destination)
+{
+    stl_in_situ_parser& parser = stl_json_detail::thread_local_parser<stl_in_situ_parser>();
+    parser.set_in_situ(true);
+    parser.set_buffer(begin, end);
+    if(parser.consume(begin, end) && parser.end())
+    {
+        parser.moveTo(destination);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief parse_projected parses a document that is entirely in memory, building only the parts selected by paths,
+ * see projection_builder. Everything else is skipped.
+ */
+inline bool parse_projected(char* begin, char* end, projection const& paths, stl_item& destination)
+{
+    stl_projection_parser& parser = stl_json_detail::thread_local_parser<stl_projection_parser>();
+    parser.set_projection(&paths);
+    if(parser.consume(begin, end) && parser.end())
+    {
+        parser.moveTo(destination);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief parse_struct parses a document that is entirely in memory straight into a struct whose json_binding is
+ * specialized, see struct_binder
+ */
+template<typename T>
+inline bool parse_struct(char* begin, char* end, T& destination)
+{
+    using parser_type = parser_bits<stdvector, struct_binder<stdvector, T>, std::vector<char>, char>;
+    parser_type& parser = stl_json_detail::thread_local_parser<parser_type>();
+    if(parser.consume(begin, end) && parser.end())
+    {
+        parser.moveTo(destination);
+        return true;
+    }
+    return false;
+}
+
 template<typename stream>
 inline bool parse_from_stream(stream & f, stl_item& destination)
 {
-    stl_parser parser;
+    stl_parser& parser = stl_json_detail::thread_local_parser<stl_parser>();
     constexpr const int buffersize = 65536;
     char buf[buffersize];
     bool good = true;
@@ -111,19 +265,43 @@ inline bool parse_from_stream(stream & f, stl_item& destination)
     return false;
 }
 
+/**
+ * @brief parse_one_document parses the first document from the stream, and leaves the stream right after it.
+ * Seekable streams are read by blocks, and positioned back after the end of the document. Other streams are
+ * read one character at a time.
+ */
 template<typename stream>
 inline bool parse_one_document(stream & f, stl_item& destination)
 {
-    stl_parser parser;
+    stl_parser& parser = stl_json_detail::thread_local_parser<stl_parser>();
     bool good = true;
     if(!f.good())
         return false;
-    while(good && f.good() && !parser.complete_without_error())
+    auto const start = f.tellg();
+    if(start != decltype(start)(-1))
     {
-        char c;
-        f.get(c);
-        if(f.good())
-            good = parser.consume(c);
+        constexpr const int buffersize = 65536;
+        char buf[buffersize];
+        std::size_t used = 0;
+        while(good && f.good() && !parser.complete_without_error())
+        {
+            std::size_t ret = static_cast<std::size_t>(f.read(buf, buffersize).gcount());
+            auto res = parser.consume_document(buf, buf + ret);
+            good = res.first;
+            used += res.second;
+        }
+        f.clear();
+        f.seekg(start + static_cast<typename stream::off_type>(used));
+    }
+    else
+    {
+        while(good && f.good() && !parser.complete_without_error())
+        {
+            char c;
+            f.get(c);
+            if(f.good())
+                good = parser.consume(c);
+        }
     }
     if(good && parser.end())
     {
@@ -0,0 +1,574 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_STRUCT_BINDING_H
+#define JBC_JSON_STRUCT_BINDING_H
+
+#include "handler_result.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#ifndef JSON_BINDING_MAX_KEY_LENGTH
+#define JSON_BINDING_MAX_KEY_LENGTH 64
+#endif
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * @brief The field struct binds a json key to a member of Struct
+ */
+template<typename Struct, typename Member>
+struct field
+{
+    std::string_view key;
+    Member Struct::* member;
+};
+
+/**
+ * @brief json_field makes a field, deducing its types
+ */
+template<typename Struct, typename Member>
+constexpr field<Struct, Member> json_field(std::string_view key, Member Struct::* member)
+{
+    return field<Struct, Member>{key, member};
+}
+
+/**
+ * @brief The json_binding struct must be specialized for every bound struct, with a fields tuple of field :
+ *
+ *     template<> struct json_binding<point>
+ *     {
+ *         static constexpr auto fields = std::make_tuple(json_field("x", &point::x),
+ *                                                        json_field("y", &point::y));
+ *     };
+ *
+ * Members can be bool, arithmetic types, strings (any sequence of char, such as std::string or a static_vector
+ * of char), bound structs, and sequences of them (std::vector, static_vector...). Keys that are not bound are
+ * skipped. null leaves the member untouched.
+ */
+template<typename T>
+struct json_binding;
+
+/**
+ * @brief is_bound tells whether json_binding is specialized for T
+ */
+template<typename T, typename = void>
+struct is_bound : std::false_type {};
+
+template<typename T>
+struct is_bound<T, std::void_t<decltype(json_binding<T>::fields)> > : std::true_type {};
+
+namespace binding_detail
+{
+
+template<typename T, typename = void>
+struct is_sequence : std::false_type {};
+
+template<typename T>
+struct is_sequence<T, std::void_t<typename T::value_type, decltype(std::declval<T&>().push_back(std::declval<typename T::value_type>())),
+        decltype(std::declval<T&>().max_size())> > : std::true_type {};
+
+template<typename T, typename = void>
+struct is_string : std::false_type {};
+
+template<typename T>
+struct is_string<T, std::enable_if_t<is_sequence<T>::value && std::is_same_v<typename T::value_type, char> > > :
+        std::true_type {};
+
+/**
+ * @brief key_hash is the FNV-1a hash of key, salted with seed
+ */
+constexpr std::uint32_t key_hash(std::string_view key, std::uint32_t seed)
+{
+    std::uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for(char c : key)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 16);
+}
+
+constexpr std::size_t next_power_of_two(std::size_t value)
+{
+    std::size_t result = 1;
+    while(result < value)
+        result *= 2;
+    return result;
+}
+
+/**
+ * @brief The perfect_hash struct maps the N keys of a struct to distinct slots. It is computed at compile
+ * time, by trying seeds and table sizes until there is no collision.
+ */
+template<std::size_t N>
+struct perfect_hash
+{
+    static constexpr std::size_t capacity = 2 * next_power_of_two(4 * N);
+    std::array<std::string_view, N> keys{};
+    std::array<std::uint8_t, capacity> slots{}; // index of the key + 1, 0 if empty
+    std::size_t mask = 0;
+    std::uint32_t seed = 0;
+
+    /**
+     * @brief find returns the index of key, or N
+     */
+    constexpr std::size_t find(std::string_view key) const
+    {
+        std::size_t const slot = slots[key_hash(key, seed) & mask];
+        if(slot == 0 || keys[slot - 1] != key)
+            return N;
+        return slot - 1;
+    }
+};
+
+template<std::size_t N>
+constexpr perfect_hash<N> make_perfect_hash(std::array<std::string_view, N> const& keys)
+{
+    static_assert(N < 255, "too many bound keys");
+    perfect_hash<N> result;
+    result.keys = keys;
+    for(std::size_t size = perfect_hash<N>::capacity / 4; size <= perfect_hash<N>::capacity; size *= 2)
+    {
+        for(std::uint32_t seed = 0; seed < 1024; ++seed)
+        {
+            result.slots = std::array<std::uint8_t, perfect_hash<N>::capacity>{};
+            bool collision = false;
+            for(std::size_t i = 0; i < N && !collision; ++i)
+            {
+                if(keys[i].size() > JSON_BINDING_MAX_KEY_LENGTH)
+                    throw "bound key longer than JSON_BINDING_MAX_KEY_LENGTH";
+                std::uint8_t& slot = result.slots[key_hash(keys[i], seed) & (size - 1)];
+                collision = slot != 0;
+                slot = static_cast<std::uint8_t>(i + 1);
+            }
+            if(!collision)
+            {
+                result.mask = size - 1;
+                result.seed = seed;
+                return result;
+            }
+        }
+    }
+    throw "no perfect hash found, are there duplicate keys ?";
+}
+
+struct value_ops;
+
+/**
+ * @brief The slot struct is a value being written : its address, and how to write it
+ */
+struct slot
+{
+    void* ptr = nullptr;
+    value_ops const* ops = nullptr;
+};
+
+/**
+ * @brief The value_ops struct tells how to write the values of a type. Null members are json types the C++ type
+ * does not accept.
+ */
+struct value_ops
+{
+    bool (*boolean)(void* ptr, bool value);
+    bool (*number)(void* ptr, double value);
+    /** integral numbers, read exactly from their digits */
+    bool (*exact_integer)(void* ptr, bool negative, std::uint64_t magnitude);
+    bool (*clear_string)(void* ptr);
+    bool (*append_string)(void* ptr, std::string_view value);
+    /** appends an element to a sequence, and sets element to it */
+    bool (*add_element)(void* ptr, slot& element);
+    /** finds the member of a bound struct for key */
+    bool (*find_member)(void* ptr, std::string_view key, slot& member);
+};
+
+template<typename T>
+struct ops_of;
+
+/**
+ * @brief The bound_struct struct holds the compile time key table of a bound struct, and dispatches keys to
+ * its members
+ */
+template<typename T>
+struct bound_struct
+{
+    using fields_type = std::remove_cv_t<decltype(json_binding<T>::fields)>;
+    static constexpr std::size_t count = std::tuple_size_v<fields_type>;
+
+    template<std::size_t... I>
+    static constexpr std::array<std::string_view, count> keys_(std::index_sequence<I...>)
+    {
+        return {{std::get<I>(json_binding<T>::fields).key...}};
+    }
+
+    static constexpr perfect_hash<count> table = make_perfect_hash<count>(keys_(std::make_index_sequence<count>()));
+
+    template<std::size_t I>
+    static bool member_(T* object, slot& member)
+    {
+        auto& value = object->*(std::get<I>(json_binding<T>::fields).member);
+        member = slot{&value, &ops_of<std::remove_reference_t<decltype(value)> >::ops};
+        return true;
+    }
+
+    template<std::size_t... I>
+    static bool dispatch_(std::size_t index, T* object, slot& member, std::index_sequence<I...>)
+    {
+        return ((index == I && member_<I>(object, member)) || ...);
+    }
+
+    static bool find_member(void* ptr, std::string_view key, slot& member)
+    {
+        std::size_t const index = table.find(key);
+        if(index == count)
+            return false;
+        return dispatch_(index, static_cast<T*>(ptr), member, std::make_index_sequence<count>());
+    }
+};
+
+template<typename T>
+struct ops_of
+{
+    static bool boolean(void* ptr, bool value)
+    {
+        *static_cast<T*>(ptr) = value;
+        return true;
+    }
+
+    static bool number(void* ptr, double value)
+    {
+        if constexpr(std::is_integral_v<T>)
+        {
+            // integral members only take integral values that fit, and that a double holds exactly
+            if(!(value > -9007199254740992. && value < 9007199254740992.) ||
+                    !(value >= static_cast<double>(std::numeric_limits<T>::min()) &&
+                 value < static_cast<double>(std::numeric_limits<T>::max()) + 1.) ||
+                    static_cast<double>(static_cast<T>(value)) != value)
+                return false;
+        }
+        *static_cast<T*>(ptr) = static_cast<T>(value);
+        return true;
+    }
+
+    static bool exact_integer(void* ptr, bool negative, std::uint64_t magnitude)
+    {
+        if constexpr(std::is_integral_v<T>)
+        {
+            if(!negative || magnitude == 0)
+            {
+                if(magnitude > static_cast<std::uint64_t>(std::numeric_limits<T>::max()))
+                    return false;
+                *static_cast<T*>(ptr) = static_cast<T>(magnitude);
+            }
+            else
+            {
+                // -magnitude, computed without overflowing for the minimum value
+                if constexpr(std::is_unsigned_v<T>)
+                    return false;
+                else
+                {
+                    if(magnitude - 1 > static_cast<std::uint64_t>(std::numeric_limits<T>::max()))
+                        return false;
+                    *static_cast<T*>(ptr) = static_cast<T>(-static_cast<std::int64_t>(magnitude - 1) - 1);
+                }
+            }
+        }
+        else
+            *static_cast<T*>(ptr) = negative ? -static_cast<T>(magnitude) : static_cast<T>(magnitude);
+        return true;
+    }
+
+    static bool clear_string(void* ptr)
+    {
+        static_cast<T*>(ptr)->clear();
+        return true;
+    }
+
+    static bool append_string(void* ptr, std::string_view value)
+    {
+        T& str = *static_cast<T*>(ptr);
+        if(value.size() > str.max_size() - str.size()) // static_vector : no room left
+            return false;
+        str.insert(str.end(), value.begin(), value.end());
+        return true;
+    }
+
+    static bool add_element(void* ptr, slot& element)
+    {
+        T& sequence = *static_cast<T*>(ptr);
+        if(sequence.size() == sequence.max_size())
+            return false;
+        sequence.emplace_back();
+        element = slot{&sequence.back(), &ops_of<typename T::value_type>::ops};
+        return true;
+    }
+
+    static constexpr value_ops make_ops()
+    {
+        value_ops result{};
+        if constexpr(std::is_same_v<T, bool>)
+            result.boolean = &boolean;
+        else if constexpr(std::is_arithmetic_v<T>)
+        {
+            result.number = &number;
+            result.exact_integer = &exact_integer;
+        }
+        else if constexpr(is_string<T>::value)
+        {
+            result.clear_string = &clear_string;
+            result.append_string = &append_string;
+        }
+        else if constexpr(is_bound<T>::value)
+            result.find_member = &bound_struct<T>::find_member;
+        else if constexpr(is_sequence<T>::value)
+            result.add_element = &add_element;
+        else
+            static_assert(is_bound<T>::value, "type can not be bound, is json_binding specialized ?");
+        return result;
+    }
+
+    static constexpr value_ops ops = make_ops();
+};
+
+}
+
+/**
+ * The struct_binder class is a parser callbacks policy that writes a document straight into a T, without building
+ * any item. T is a bound struct, or any type a member can be, such as a sequence of bound structs. Keys are matched with a perfect hash computed at
+ * compile time, then a switch on the index of the key. The values of keys that are not bound are skipped.
+ * A value of the wrong type makes the parsing fail.
+ *
+ * container is the stack of opened arrays and objects, such as stdvector, or static_vector which, along with
+ * static_vector members, makes parsing free of allocations.
+ */
+template<template<class> class container, typename T>
+class struct_binder
+{
+    T value_{};
+    container<binding_detail::slot> frames_; // opened arrays and objects
+    binding_detail::slot pending_; // member of the last key
+    binding_detail::slot string_; // string being written
+    std::array<char, JSON_BINDING_MAX_KEY_LENGTH> key_;
+    std::size_t key_size_ = 0; // larger than key_ if the key is too long to be bound
+    bool root_done_ = false;
+
+    /**
+     * @brief next_value_ returns the slot of the value that begins
+     */
+    bool next_value_(binding_detail::slot& s);
+
+protected:
+    // ARRAY
+    bool begin_array_handler();
+    bool end_array_handler();
+
+    // OBJECT
+    bool begin_object_handler();
+    bool end_object_handler();
+
+    // SCALARS
+    bool boolean_handler(bool value);
+    bool double_handler(double value);
+#ifdef JSON_USE_LONG_INTEGERS
+    bool integer_handler(int64_t value);
+#endif
+    bool exact_integer_handler(bool negative, std::uint64_t magnitude);
+    bool null_handler();
+
+    // STRING
+    bool begin_string_handler();
+    bool string_content_handler(std::string_view value);
+    bool end_string_handler();
+
+    // KEY
+    bool begin_key_handler();
+    bool key_content_handler(std::string_view value);
+    handler_result end_key_handler();
+
+public:
+    /**
+     * @brief value returns the struct being written. May be partially written if parsing failed.
+     */
+    T const& value() const;
+
+    /**
+     * @brief moveTo moves the struct to dest. The internal struct is discarded.
+     */
+    void moveTo(T& dest);
+
+    /**
+     * @brief reset discards the struct being written, so that the binder can be used for another document
+     */
+    void reset();
+};
+
+template<template<class> class container, typename T>
+T const& struct_binder<container, T>::value() const
+{
+    return value_;
+}
+
+template<template<class> class container, typename T>
+void struct_binder<container, T>::moveTo(T& dest)
+{
+    dest = std::move(value_);
+}
+
+template<template<class> class container, typename T>
+void struct_binder<container, T>::reset()
+{
+    value_ = T{};
+    frames_.clear();
+    pending_ = binding_detail::slot();
+    string_ = binding_detail::slot();
+    key_size_ = 0;
+    root_done_ = false;
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::next_value_(binding_detail::slot& s)
+{
+    if(frames_.empty())
+    {
+        if(root_done_)
+            return false;
+        root_done_ = true;
+        s = binding_detail::slot{&value_, &binding_detail::ops_of<T>::ops};
+        return true;
+    }
+    binding_detail::slot const& parent = frames_.back();
+    if(parent.ops->add_element != nullptr)
+        return parent.ops->add_element(parent.ptr, s);
+    s = pending_;
+    return true;
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::begin_array_handler()
+{
+    binding_detail::slot s;
+    if(!next_value_(s) || s.ops->add_element == nullptr)
+        return false;
+    frames_.push_back(s);
+    return true;
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::end_array_handler()
+{
+    frames_.pop_back();
+    return true;
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::begin_object_handler()
+{
+    binding_detail::slot s;
+    if(!next_value_(s) || s.ops->find_member == nullptr)
+        return false;
+    frames_.push_back(s);
+    return true;
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::end_object_handler()
+{
+    frames_.pop_back();
+    return true;
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::boolean_handler(bool value)
+{
+    binding_detail::slot s;
+    return next_value_(s) && s.ops->boolean != nullptr && s.ops->boolean(s.ptr, value);
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::double_handler(double value)
+{
+    binding_detail::slot s;
+    return next_value_(s) && s.ops->number != nullptr && s.ops->number(s.ptr, value);
+}
+
+#ifdef JSON_USE_LONG_INTEGERS
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::integer_handler(int64_t value)
+{
+    return exact_integer_handler(value < 0, value < 0 ? 0 - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value));
+}
+#endif
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::exact_integer_handler(bool negative, std::uint64_t magnitude)
+{
+    binding_detail::slot s;
+    return next_value_(s) && s.ops->exact_integer != nullptr && s.ops->exact_integer(s.ptr, negative, magnitude);
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::null_handler()
+{
+    binding_detail::slot s;
+    return next_value_(s); // the member keeps its value
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::begin_string_handler()
+{
+    return next_value_(string_) && string_.ops->clear_string != nullptr && string_.ops->clear_string(string_.ptr);
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::string_content_handler(std::string_view value)
+{
+    return string_.ops->append_string(string_.ptr, value);
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::end_string_handler()
+{
+    return true;
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::begin_key_handler()
+{
+    key_size_ = 0;
+    return true;
+}
+
+template<template<class> class container, typename T>
+bool struct_binder<container, T>::key_content_handler(std::string_view value)
+{
+    if(key_size_ + value.size() <= key_.size())
+        std::copy(value.begin(), value.end(), key_.begin() + static_cast<std::ptrdiff_t>(key_size_));
+    key_size_ += value.size();
+    return true;
+}
+
+template<template<class> class container, typename T>
+handler_result struct_binder<container, T>::end_key_handler()
+{
+    binding_detail::slot const& object = frames_.back();
+    if(key_size_ > key_.size() || !object.ops->find_member(object.ptr, std::string_view(key_.data(), key_size_), pending_))
+        return handler_result::skip;
+    return handler_result::proceed;
+}
+
+}
+}
+
+#endif // JBC_JSON_STRUCT_BINDING_H
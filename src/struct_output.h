@@ -0,0 +1,325 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_STRUCT_OUTPUT_H
+#define JBC_JSON_STRUCT_OUTPUT_H
+
+#include "output.h"
+#include "struct_binding.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+namespace jbc
+{
+namespace json
+{
+
+namespace binding_detail
+{
+
+/**
+ * @brief escaped_size returns the size of key once escaped, without the quotes
+ */
+constexpr std::size_t escaped_size(std::string_view key)
+{
+    std::size_t size = 0;
+    for(char c : key)
+    {
+        if(c == '"' || c == '\\')
+            size += 2;
+        else if(static_cast<unsigned char>(c) < 0x20)
+            size += 6; // \u00XX
+        else
+            size += 1;
+    }
+    return size;
+}
+
+/**
+ * @brief The key_literal struct is the text written for the field I of T, computed at compile time : the
+ * separator from the previous field if any, the escaped and quoted key, and the colon
+ */
+template<typename T, std::size_t I>
+struct key_literal
+{
+    static constexpr std::string_view key = std::get<I>(json_binding<T>::fields).key;
+    static constexpr std::size_t size = escaped_size(key) + (I > 0 ? 4 : 3);
+
+    static constexpr std::array<char, size> make()
+    {
+        std::array<char, size> result{};
+        std::size_t pos = 0;
+        if(I > 0)
+            result[pos++] = ',';
+        result[pos++] = '"';
+        for(char c : key)
+        {
+            unsigned char const v = static_cast<unsigned char>(c);
+            if(c == '"' || c == '\\')
+            {
+                result[pos++] = '\\';
+                result[pos++] = c;
+            }
+            else if(v < 0x20)
+            {
+                char const digits[] = "0123456789ABCDEF";
+                result[pos++] = '\\';
+                result[pos++] = 'u';
+                result[pos++] = '0';
+                result[pos++] = '0';
+                result[pos++] = digits[v >> 4];
+                result[pos++] = digits[v & 0xF];
+            }
+            else
+                result[pos++] = c;
+        }
+        result[pos++] = '"';
+        result[pos++] = ':';
+        return result;
+    }
+
+    static constexpr std::array<char, size> text = make();
+};
+
+}
+
+/**
+ * The struct_output class writes a value whose type can be bound (see json_binding) into a buffer, with the
+ * resumable output primitives : when the buffer is full, it returns false, and the locator tells where to resume
+ * with the next buffer. Nothing is copied into an item, and keys are written from literals escaped and quoted at
+ * compile time. Non ASCII characters of keys are written as is.
+ *
+ * traits provides the string output functions, such as stl_types.
+ */
+template<typename traits, typename locator = basic_locator>
+class struct_output
+{
+    using base = output<typename traits::char_type, locator>;
+
+    /**
+     * @brief double_precision is the precision of floating point members, as output_visitor
+     */
+    static constexpr int double_precision = 10;
+
+    template<typename buffer>
+    static bool text_(char const* text, std::size_t size, locator& loc, buffer& buf, int& offset);
+
+    template<std::size_t N, typename buffer>
+    static bool literal_(std::array<char, N> const& text, locator& loc, buffer& buf, int& offset)
+    {
+        return text_(text.data(), N, loc, buf, offset);
+    }
+
+    template<typename buffer>
+    static bool unsigned_(std::uint64_t value, locator& loc, buffer& buf, int& offset);
+
+    template<typename T, typename buffer>
+    static bool object_(T const& value, locator& loc, buffer& buf, int& offset);
+
+    template<typename T, std::size_t I, typename buffer>
+    static bool field_(T const& value, std::uint8_t& phase, locator& loc, buffer& buf, int& offset);
+
+    template<typename T, typename buffer, std::size_t... I>
+    static bool fields_(T const& value, std::size_t index, std::uint8_t& phase, locator& loc, buffer& buf, int& offset,
+                        std::index_sequence<I...>);
+
+    template<typename T, typename buffer>
+    static bool sequence_(T const& value, locator& loc, buffer& buf, int& offset);
+
+    /**
+     * @brief child_ returns the locator of the child being written : the saved one when resuming, else empty
+     */
+    static locator& child_(locator& loc, locator& empty)
+    {
+        return loc.position_in_subitem != nullptr ? *loc.position_in_subitem : empty;
+    }
+    /**
+     * @brief suspend_ saves the locator of the child, so that it is resumed with the next buffer
+     */
+    static bool suspend_(locator& loc, locator& child)
+    {
+        if(loc.position_in_subitem == nullptr)
+            loc.position_in_subitem = std::make_unique<locator>(std::move(child));
+        return false;
+    }
+
+public:
+    /**
+     * @brief value writes value into the buffer, starting at offset
+     * @return true if written completely, false if the buffer is full
+     * @remark When returning true, the locator is reset.
+     */
+    template<typename T, typename buffer>
+    static bool value(T const& value, locator& loc, buffer& buf, int& offset);
+};
+
+template<typename traits, typename locator>
+template<typename buffer>
+bool struct_output<traits, locator>::text_(char const* text, std::size_t size, locator& loc, buffer& buf, int& offset)
+{
+    std::size_t const done = static_cast<std::size_t>(loc.position);
+    std::size_t const written = std::min(size - done, buf.size() - static_cast<std::size_t>(offset));
+    std::copy(text + done, text + done + written, buf.data() + offset);
+    offset += static_cast<int>(written);
+    loc.position += static_cast<int>(written);
+    if(done + written < size)
+        return false;
+    loc.reset();
+    return true;
+}
+
+template<typename traits, typename locator>
+template<typename buffer>
+bool struct_output<traits, locator>::unsigned_(std::uint64_t value, locator& loc, buffer& buf, int& offset)
+{
+    if(value <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+        return base::integer(static_cast<std::int64_t>(value), loc, buf, offset);
+    // does not fit in the integer primitive : the digits are computed again when resuming
+    char digits[20];
+    std::size_t pos = sizeof(digits);
+    for(; value != 0; value /= 10)
+        digits[--pos] = static_cast<char>('0' + value % 10);
+    return text_(digits + pos, sizeof(digits) - pos, loc, buf, offset);
+}
+
+template<typename traits, typename locator>
+template<typename T, typename buffer>
+bool struct_output<traits, locator>::value(T const& value, locator& loc, buffer& buf, int& offset)
+{
+    if constexpr(std::is_same_v<T, bool>)
+        return base::boolean(value, loc, buf, offset);
+    else if constexpr(std::is_integral_v<T> && std::is_unsigned_v<T> && sizeof(T) >= sizeof(std::int64_t))
+        return unsigned_(static_cast<std::uint64_t>(value), loc, buf, offset);
+    else if constexpr(std::is_integral_v<T>)
+        return base::integer(static_cast<std::int64_t>(value), loc, buf, offset);
+    else if constexpr(std::is_floating_point_v<T>)
+        return base::number(static_cast<double>(value), double_precision, loc, buf, offset);
+    else if constexpr(binding_detail::is_string<T>::value)
+    {
+        typename traits::string_view view(value.data(), value.size());
+        return base::template string<traits, typename traits::string_view, buffer>(view, loc, buf, offset);
+    }
+    else if constexpr(is_bound<T>::value)
+        return object_(value, loc, buf, offset);
+    else
+    {
+        static_assert(binding_detail::is_sequence<T>::value, "type can not be written, is json_binding specialized ?");
+        return sequence_(value, loc, buf, offset);
+    }
+}
+
+template<typename traits, typename locator>
+template<typename T, typename buffer>
+bool struct_output<traits, locator>::object_(T const& value, locator& loc, buffer& buf, int& offset)
+{
+    constexpr std::size_t count = binding_detail::bound_struct<T>::count;
+    if(loc.position == 0)
+    {
+        if(!base::object_start(buf, offset))
+            return false;
+        loc.position = 1;
+    }
+    while(static_cast<std::size_t>(loc.position) <= count)
+    {
+        locator empty;
+        locator& child = child_(loc, empty);
+        if(!fields_(value, static_cast<std::size_t>(loc.position - 1), loc.sub_position, child, buf, offset,
+                    std::make_index_sequence<count>()))
+            return suspend_(loc, child);
+        loc.position_in_subitem.reset();
+        loc.sub_position = 0;
+        loc.position += 1;
+    }
+    if(!base::object_end(buf, offset))
+        return false;
+    loc.reset();
+    return true;
+}
+
+template<typename traits, typename locator>
+template<typename T, typename buffer, std::size_t... I>
+bool struct_output<traits, locator>::fields_(T const& value, std::size_t index, std::uint8_t& phase, locator& loc,
+                                              buffer& buf, int& offset, std::index_sequence<I...>)
+{
+    bool result = false;
+    ((index == I && (result = field_<T, I>(value, phase, loc, buf, offset), true)) || ...);
+    return result;
+}
+
+template<typename traits, typename locator>
+template<typename T, std::size_t I, typename buffer>
+bool struct_output<traits, locator>::field_(T const& value, std::uint8_t& phase, locator& loc, buffer& buf, int& offset)
+{
+    if(phase == 0) // key
+    {
+        if(!literal_(binding_detail::key_literal<T, I>::text, loc, buf, offset))
+            return false;
+        phase = 1;
+    }
+    return struct_output::value(value.*(std::get<I>(json_binding<T>::fields).member), loc, buf, offset);
+}
+
+template<typename traits, typename locator>
+template<typename T, typename buffer>
+bool struct_output<traits, locator>::sequence_(T const& value, locator& loc, buffer& buf, int& offset)
+{
+    if(loc.position == 0)
+    {
+        if(!base::array_start(buf, offset))
+            return false;
+        loc.position = 1;
+    }
+    auto it = std::next(std::begin(value), loc.position - 1);
+    for(auto end = std::end(value); it != end; ++it)
+    {
+        if(loc.sub_position == 0)
+        {
+            if(loc.position > 1 && !base::array_separator(buf, offset))
+                return false;
+            loc.sub_position = 1;
+        }
+        locator empty;
+        locator& child = child_(loc, empty);
+        if(!struct_output::value(*it, child, buf, offset))
+            return suspend_(loc, child);
+        loc.position_in_subitem.reset();
+        loc.sub_position = 0;
+        loc.position += 1;
+    }
+    if(!base::array_end(buf, offset))
+        return false;
+    loc.reset();
+    return true;
+}
+
+/**
+ * @brief output_struct writes value to stream, as output_json does for items
+ */
+template<typename traits, typename ostream, typename T, typename locator = basic_locator>
+bool output_struct(ostream& stream, T const& value)
+{
+    std::array<typename traits::char_type, 32768> buf;
+    locator loc;
+    int offset = 0;
+    bool res = false;
+    while(!res && stream.good())
+    {
+        res = struct_output<traits, locator>::value(value, loc, buf, offset);
+        stream.write(buf.data(), offset);
+        offset = 0;
+    }
+    return res && stream.good();
+}
+
+}
+}
+
+#endif // JBC_JSON_STRUCT_OUTPUT_H
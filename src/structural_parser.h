@@ -0,0 +1,795 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_STRUCTURAL_PARSER_H
+#define JBC_JSON_STRUCTURAL_PARSER_H
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "handler_result.h"
+#include "helper_functions.h"
+#include "scan_helpers.h"
+
+#if defined(__PCLMUL__)
+#include <wmmintrin.h>
+#endif
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * @brief The structural_masks struct holds the classification of a 64 bytes block, one bit per byte
+ */
+struct structural_masks
+{
+    std::uint64_t quote = 0;
+    std::uint64_t backslash = 0;
+    /** , : [ ] { } */
+    std::uint64_t structural = 0;
+    std::uint64_t whitespace = 0;
+};
+
+/**
+ * @brief prefix_xor computes, for every bit, the xor of all the bits up to (and including) it. Applied to
+ * the quote mask, this gives the mask of the bytes that are inside a string
+ */
+inline std::uint64_t prefix_xor(std::uint64_t bits)
+{
+#if defined(__PCLMUL__)
+    __m128i const all_ones = _mm_set1_epi8(static_cast<char>(0xFF));
+    __m128i const result = _mm_clmulepi64_si128(
+                _mm_set_epi64x(0, static_cast<long long>(bits)), all_ones, 0);
+    return static_cast<std::uint64_t>(_mm_cvtsi128_si64(result));
+#else
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+#endif
+}
+
+/**
+ * @brief classify_block classifies the 64 bytes starting at block.
+ */
+inline structural_masks classify_block(char const* block)
+{
+    structural_masks m;
+#if defined(__AVX2__)
+    for(int k = 0; k < 2; ++k)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(block + 32 * k));
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20)); // [ -> {, ] -> }
+        __m256i structural = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')),
+                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':'))),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')),
+                                    _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))));
+        __m256i whitespace = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+        auto bits = [](__m256i x) {
+            return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(x)));
+        };
+        m.quote |= bits(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << (32 * k);
+        m.backslash |= bits(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << (32 * k);
+        m.structural |= bits(structural) << (32 * k);
+        m.whitespace |= bits(whitespace) << (32 * k);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for(int k = 0; k < 4; ++k)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(block + 16 * k));
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20)); // [ -> {, ] -> }
+        __m128i structural = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(',')),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8(':'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+                                 _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))));
+        __m128i whitespace = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        auto bits = [](__m128i x) {
+            return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(x)));
+        };
+        m.quote |= bits(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << (16 * k);
+        m.backslash |= bits(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << (16 * k);
+        m.structural |= bits(structural) << (16 * k);
+        m.whitespace |= bits(whitespace) << (16 * k);
+    }
+#else
+    for(int k = 0; k < 64; ++k)
+    {
+        std::uint64_t const bit = std::uint64_t{1} << k;
+        switch(block[k])
+        {
+            case '"': m.quote |= bit; break;
+            case '\\': m.backslash |= bit; break;
+            case ',': case ':': case '[': case ']': case '{': case '}': m.structural |= bit; break;
+            case ' ': case '\t': case '\n': case '\r': m.whitespace |= bit; break;
+            default: break;
+        }
+    }
+#endif
+    return m;
+}
+
+/**
+ * The structural_parser class parses a json document that is entirely available in memory, in two stages.
+ * The first stage builds, 64 bytes at a time, an index of the positions of the structural characters,
+ * of the quotes and of the start of scalar values, using bit masks to find which bytes are inside strings.
+ * The second stage walks this index and fires the same callbacks as parser_bits, so that item_builder and
+ * custom handlers can be used with both parsers.
+ *
+ * Unlike parser_bits, this parser is not incremental : the whole document must be given at once. It only
+ * supports single byte characters, and documents smaller than 4GB.
+ */
+template<template<class> class container,
+            typename parser_callbacks,
+            typename buffer_type_,
+            typename char_type_>
+class structural_parser :
+    public parser_callbacks
+{
+    static_assert(sizeof(char_type_) == 1, "structural_parser only handles single byte characters");
+
+protected:
+    enum class Expect : std::uint8_t
+    {
+        Value,
+        FirstArrayValue,
+        FirstKey,
+        Key,
+        ArrayNext,
+        ObjectNext,
+        Done
+    };
+
+    /**
+     * @brief indexes_ is the output of stage 1 : offsets of structural characters, quotes and scalar starts
+     */
+    std::vector<std::uint32_t> indexes_;
+    /**
+     * @brief stack_ stores, for every opened container, whether it is an object (true) or an array
+     */
+    container<bool> stack_;
+    buffer_type_ lastValue_;
+    bool error_ = false;
+    bool complete_ = false;
+    bool skip_next_value_ = false; // set when end_key_handler asks to skip the value of the key
+    char const* err_ = nullptr;
+
+    bool make_error(char const* message);
+    bool parse_(char_type_* begin, char_type_* end, bool list);
+    bool build_index_(char_type_* begin, char_type_* end);
+    /**
+     * @brief walk_index_ fires the callbacks for the indexed document
+     * @param list true if the document is a list of values, the elements of an array whose brackets are not given
+     */
+    bool walk_index_(char_type_* begin, char_type_* end, bool list);
+    Expect after_value_() const;
+    /**
+     * @brief skip_value_ skips the value whose first index is i, by counting brackets. Strings are a pair of
+     * indexes, and nothing inside them is indexed.
+     * @param i set to the index after the value
+     */
+    bool skip_value_(char_type_* begin, std::size_t& i);
+    bool string_(char_type_* first, char_type_* last, bool is_key);
+    bool emit_content_(char_type_* first, std::size_t size, bool is_key);
+    bool escape_(char_type_*& cur, char_type_* last, bool is_key);
+    bool number_(char_type_* first, char_type_* last);
+    static bool is_scalar_end_(char_type_ c);
+
+public:
+    using buffer_type = buffer_type_;
+    using char_type = char_type_;
+
+    /**
+     * @brief parse parses a complete document
+     * @param begin start of the document
+     * @param end end of the document
+     * @return true if the document is valid and all handlers succeeded, false otherwise
+     */
+    bool parse(char_type_* begin, char_type_* end);
+
+    /**
+     * @brief parse_list parses a comma separated list of values, the elements of an array without its brackets.
+     * The callbacks get the same events as for the whole array, so that a part of a large array can be parsed in
+     * place.
+     * @return true if the list is valid and all handlers succeeded, false otherwise
+     */
+    bool parse_list(char_type_* begin, char_type_* end);
+
+    /**
+     * @brief reset prepares the parser for another document. The index and the stacks keep their capacity. The
+     * callbacks are reset too, if they provide a reset() member.
+     */
+    void reset();
+
+    /**
+     * @brief complete_without_error tells whether the last parse succeeded
+     */
+    bool complete_without_error() const;
+
+    /**
+     * @brief error_message returns a pointer to an error message set by the parser. Do not free this message.
+     * @return null pointer if no error, pointer to a NULL terminated string otherwise.
+     */
+    char const* error_message() const;
+};
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+void structural_parser<container,parser_callbacks, buffer_type_, char_type_>::reset()
+{
+    error_ = false;
+    complete_ = false;
+    skip_next_value_ = false;
+    err_ = nullptr;
+    stack_.clear();
+    helper_functions<buffer_type_, char_type_>::truncate(lastValue_);
+    if constexpr(has_reset<parser_callbacks>::value)
+        parser_callbacks::reset();
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::parse(char_type_* begin, char_type_* end)
+{
+    return parse_(begin, end, false);
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::parse_list(char_type_* begin, char_type_* end)
+{
+    return parse_(begin, end, true);
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::parse_(char_type_* begin, char_type_* end, bool list)
+{
+    error_ = false;
+    complete_ = false;
+    skip_next_value_ = false;
+    err_ = nullptr;
+    if(static_cast<std::uint64_t>(end - begin) >= std::numeric_limits<std::uint32_t>::max())
+        return make_error("Document too large for structural index");
+    if(!build_index_(begin, end))
+        return false;
+    if(!walk_index_(begin, end, list))
+        return false;
+    complete_ = true;
+    return true;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::build_index_(char_type_* begin, char_type_* end)
+{
+    indexes_.clear();
+    std::uint64_t prev_escaped = 0; // 1 if the first byte of the next block is escaped
+    std::uint64_t prev_in_string = 0; // all ones if the previous block ended inside a string
+    std::uint64_t prev_scalar = 0; // 1 if the previous block ended inside a scalar
+    std::size_t const size = static_cast<std::size_t>(end - begin);
+    char tail[64];
+    for(std::size_t pos = 0; pos < size; pos += 64)
+    {
+        char const* block = reinterpret_cast<char const*>(begin) + pos;
+        std::size_t const len = size - pos;
+        if(len < 64)
+        {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, len);
+            block = tail;
+        }
+        structural_masks const m = classify_block(block);
+
+        // find escaped characters : a backslash sequence of odd length escapes the next character
+        std::uint64_t const even_bits = 0x5555555555555555ULL;
+        std::uint64_t const backslash = m.backslash & ~prev_escaped;
+        std::uint64_t const follows_escape = (backslash << 1) | prev_escaped;
+        std::uint64_t const odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+        std::uint64_t const sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+        prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts ? 1 : 0; // carry out
+        std::uint64_t const invert_mask = sequences_starting_on_even_bits << 1;
+        std::uint64_t const escaped = (even_bits ^ invert_mask) & follows_escape;
+
+        std::uint64_t const quote = m.quote & ~escaped;
+        std::uint64_t const in_string = prefix_xor(quote) ^ prev_in_string; // opening quote included, closing excluded
+        prev_in_string = static_cast<std::uint64_t>(static_cast<std::int64_t>(in_string) >> 63);
+
+        std::uint64_t const scalar = ~(m.structural | m.whitespace | quote) & ~in_string;
+        std::uint64_t const scalar_start = scalar & ~((scalar << 1) | prev_scalar);
+        prev_scalar = scalar >> 63;
+
+        std::uint64_t tokens = (m.structural & ~in_string) | quote | scalar_start;
+        if(len < 64)
+            tokens &= (std::uint64_t{1} << len) - 1;
+        while(tokens != 0)
+        {
+            indexes_.push_back(static_cast<std::uint32_t>(pos + trailing_zeros64(tokens)));
+            tokens &= tokens - 1;
+        }
+    }
+    if(prev_in_string != 0)
+        return make_error("Unterminated string");
+    return true;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+typename structural_parser<container,parser_callbacks, buffer_type_, char_type_>::Expect
+structural_parser<container,parser_callbacks, buffer_type_, char_type_>::after_value_() const
+{
+    if(stack_.empty())
+        return Expect::Done;
+    return stack_.back() ? Expect::ObjectNext : Expect::ArrayNext;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::walk_index_(char_type_* begin, char_type_* end, bool list)
+{
+    stack_.clear();
+    std::size_t const count = indexes_.size();
+    Expect expect = Expect::Value;
+    if(list) // the outermost array is opened here, and only closed at the end of the list
+    {
+        if(to_handler_result(parser_callbacks::begin_array_handler()) == handler_result::fail)
+            return make_error("begin_array_handler failed");
+        stack_.push_back(false);
+        if(count == 0)
+            expect = Expect::ArrayNext;
+    }
+    else
+    {
+        if(count == 0)
+            return make_error("Empty document");
+        char_type_ const first = begin[indexes_[0]];
+        if(!token_helper<char_type_>::is_token_opening_curly_bracket(first) &&
+                !token_helper<char_type_>::is_token_opening_square_bracket(first) &&
+                !token_helper<char_type_>::is_token_double_quote(first))
+            return make_error("Invalid token in Initial");
+    }
+    std::size_t i = 0;
+    while(i < count)
+    {
+        char_type_* cur = begin + indexes_[i];
+        switch(expect)
+        {
+            case Expect::FirstArrayValue:
+                if(token_helper<char_type_>::is_token_closing_square_bracket(*cur))
+                {
+                    ++i;
+                    stack_.pop_back();
+                    if(!parser_callbacks::end_array_handler())
+                        return make_error("end_array_handler failed");
+                    expect = after_value_();
+                    break;
+                }
+                [[fallthrough]];
+            case Expect::Value:
+                if(token_helper<char_type_>::is_token_opening_curly_bracket(*cur))
+                {
+                    handler_result const result = to_handler_result(parser_callbacks::begin_object_handler());
+                    if(result == handler_result::fail)
+                        return make_error("begin_object_handler failed");
+                    if(result == handler_result::skip)
+                    {
+                        if(!skip_value_(begin, i))
+                            return false;
+                        expect = after_value_();
+                        break;
+                    }
+                    ++i;
+                    stack_.push_back(true);
+                    expect = Expect::FirstKey;
+                }
+                else if(token_helper<char_type_>::is_token_opening_square_bracket(*cur))
+                {
+                    handler_result const result = to_handler_result(parser_callbacks::begin_array_handler());
+                    if(result == handler_result::fail)
+                        return make_error("begin_array_handler failed");
+                    if(result == handler_result::skip)
+                    {
+                        if(!skip_value_(begin, i))
+                            return false;
+                        expect = after_value_();
+                        break;
+                    }
+                    ++i;
+                    stack_.push_back(false);
+                    expect = Expect::FirstArrayValue;
+                }
+                else if(token_helper<char_type_>::is_token_double_quote(*cur))
+                {
+                    // inside a string, nothing is indexed : the next index is the closing quote
+                    if(!string_(cur + 1, begin + indexes_[i + 1], false))
+                        return false;
+                    i += 2;
+                    expect = after_value_();
+                }
+                else if(token_helper<char_type_>::is_token_char_t(*cur))
+                {
+                    ++i;
+                    if(end - cur < 4 || std::memcmp(cur, "true", 4) != 0 || (end - cur > 4 && !is_scalar_end_(cur[4])))
+                        return make_error("Invalid literal, expected true");
+                    if(!parser_callbacks::boolean_handler(true))
+                        return make_error("boolean_handler failed");
+                    expect = after_value_();
+                }
+                else if(token_helper<char_type_>::is_token_char_f(*cur))
+                {
+                    ++i;
+                    if(end - cur < 5 || std::memcmp(cur, "false", 5) != 0 || (end - cur > 5 && !is_scalar_end_(cur[5])))
+                        return make_error("Invalid literal, expected false");
+                    if(!parser_callbacks::boolean_handler(false))
+                        return make_error("boolean_handler failed");
+                    expect = after_value_();
+                }
+                else if(token_helper<char_type_>::is_token_char_n(*cur))
+                {
+                    ++i;
+                    if(end - cur < 4 || std::memcmp(cur, "null", 4) != 0 || (end - cur > 4 && !is_scalar_end_(cur[4])))
+                        return make_error("Invalid literal, expected null");
+                    if(!parser_callbacks::null_handler())
+                        return make_error("null_handler failed");
+                    expect = after_value_();
+                }
+                else if(token_helper<char_type_>::is_token_minussign(*cur) ||
+                        token_helper<char_type_>::is_token_zero(*cur) ||
+                        token_helper<char_type_>::is_token_digit19(*cur))
+                {
+                    ++i;
+                    char_type_* last = cur;
+                    while(last != end && !is_scalar_end_(*last))
+                        ++last;
+                    if(!number_(cur, last))
+                        return false;
+                    expect = after_value_();
+                }
+                else
+                    return make_error("Unexpected token, expected a value");
+                break;
+            case Expect::FirstKey:
+                if(token_helper<char_type_>::is_token_closing_curly_bracket(*cur))
+                {
+                    ++i;
+                    stack_.pop_back();
+                    if(!parser_callbacks::end_object_handler())
+                        return make_error("end_object_handler failed");
+                    expect = after_value_();
+                    break;
+                }
+                [[fallthrough]];
+            case Expect::Key:
+                if(!token_helper<char_type_>::is_token_double_quote(*cur))
+                    return make_error("Unexpected token, expected a key");
+                if(!string_(cur + 1, begin + indexes_[i + 1], true))
+                    return false;
+                i += 2;
+                if(i >= count || !token_helper<char_type_>::is_token_colon(begin[indexes_[i]]))
+                    return make_error("Unexpected token in ObjectKey");
+                ++i;
+                expect = Expect::Value;
+                if(skip_next_value_)
+                {
+                    skip_next_value_ = false;
+                    if(i >= count)
+                        return make_error("Unexpected end of document");
+                    if(!skip_value_(begin, i))
+                        return false;
+                    expect = after_value_();
+                }
+                break;
+            case Expect::ArrayNext:
+                ++i;
+                if(token_helper<char_type_>::is_token_comma(*cur))
+                    expect = Expect::Value;
+                else if(token_helper<char_type_>::is_token_closing_square_bracket(*cur) && (!list || stack_.size() > 1))
+                {
+                    stack_.pop_back();
+                    if(!parser_callbacks::end_array_handler())
+                        return make_error("end_array_handler failed");
+                    expect = after_value_();
+                }
+                else
+                    return make_error("Unexpected token in Array");
+                break;
+            case Expect::ObjectNext:
+                ++i;
+                if(token_helper<char_type_>::is_token_comma(*cur))
+                    expect = Expect::Key;
+                else if(token_helper<char_type_>::is_token_closing_curly_bracket(*cur))
+                {
+                    stack_.pop_back();
+                    if(!parser_callbacks::end_object_handler())
+                        return make_error("end_object_handler failed");
+                    expect = after_value_();
+                }
+                else
+                    return make_error("Unexpected token in ObjectValue");
+                break;
+            case Expect::Done:
+                return make_error("Extra data after document");
+        }
+    }
+    if(list && expect == Expect::ArrayNext && stack_.size() == 1)
+    {
+        stack_.pop_back();
+        if(!parser_callbacks::end_array_handler())
+            return make_error("end_array_handler failed");
+        expect = Expect::Done;
+    }
+    if(expect != Expect::Done)
+        return make_error("Unexpected end of document");
+    return true;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::skip_value_(char_type_* begin, std::size_t& i)
+{
+    std::size_t const count = indexes_.size();
+    std::size_t depth = 0;
+    do
+    {
+        char_type_ const c = begin[indexes_[i]];
+        if(token_helper<char_type_>::is_token_double_quote(c))
+            i += 2;
+        else if(token_helper<char_type_>::is_token_opening_curly_bracket(c) ||
+                token_helper<char_type_>::is_token_opening_square_bracket(c))
+        {
+            ++depth;
+            ++i;
+        }
+        else if(token_helper<char_type_>::is_token_closing_curly_bracket(c) ||
+                token_helper<char_type_>::is_token_closing_square_bracket(c))
+        {
+            if(depth == 0)
+                return make_error("Unexpected token, expected a value");
+            --depth;
+            ++i;
+        }
+        else if(depth == 0 && (token_helper<char_type_>::is_token_comma(c) || token_helper<char_type_>::is_token_colon(c)))
+            return make_error("Unexpected token, expected a value");
+        else
+            ++i;
+    }
+    while(depth != 0 && i < count);
+    if(depth != 0)
+        return make_error("Unexpected end of document");
+    return true;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::string_(char_type_* first, char_type_* last, bool is_key)
+{
+    bool res = is_key ? parser_callbacks::begin_key_handler() : parser_callbacks::begin_string_handler();
+    if(!res)
+        return make_error(is_key ? "begin_key_handler failed" : "begin_string_handler failed");
+    char_type_* cur = first;
+    while(cur != last)
+    {
+        char_type_* stop = scan_helper<char_type_>::find_string_special(cur, last);
+        if(stop != cur && !emit_content_(cur, static_cast<std::size_t>(stop - cur), is_key))
+            return false;
+        if(stop == last)
+            break;
+        if(!token_helper<char_type_>::is_token_backslash(*stop))
+            return make_error("Forbidden token in string");
+        cur = stop + 1;
+        if(!escape_(cur, last, is_key))
+            return false;
+    }
+    if(is_key)
+    {
+        handler_result const result = to_handler_result(parser_callbacks::end_key_handler());
+        skip_next_value_ = result == handler_result::skip;
+        res = result != handler_result::fail;
+    }
+    else
+        res = parser_callbacks::end_string_handler();
+    return res || make_error(is_key ? "key handling failure" : "string handling failure");
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::emit_content_(char_type_* first, std::size_t size, bool is_key)
+{
+    auto view = helper_functions<buffer_type_, char_type_>::make_string_view(first, size);
+    bool res = is_key ? parser_callbacks::key_content_handler(view) : parser_callbacks::string_content_handler(view);
+    return res || make_error(is_key ? "key handling failure" : "string handling failure");
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::escape_(char_type_*& cur, char_type_* last, bool is_key)
+{
+    // cur points after the backslash. An escaped character cannot be the closing quote, so cur != last
+    char_type_ c = *cur;
+    ++cur;
+    char_type_ value;
+    if(token_helper<char_type_>::is_token_backslash(c) ||
+            token_helper<char_type_>::is_token_slash(c) ||
+            token_helper<char_type_>::is_token_double_quote(c))
+        return emit_content_(cur - 1, 1, is_key);
+    else if(token_helper<char_type_>::is_token_char_b(c))
+        value = static_cast<char_type_>('\b');
+    else if(token_helper<char_type_>::is_token_char_f(c))
+        value = static_cast<char_type_>('\f');
+    else if(token_helper<char_type_>::is_token_char_n(c))
+        value = static_cast<char_type_>('\n');
+    else if(token_helper<char_type_>::is_token_char_r(c))
+        value = static_cast<char_type_>('\r');
+    else if(token_helper<char_type_>::is_token_char_t(c))
+        value = static_cast<char_type_>('\t');
+    else if(token_helper<char_type_>::is_token_char_u(c))
+    {
+        auto read_hex4 = [&cur, last](std::uint32_t& codepoint) {
+            if(last - cur < 4)
+                return false;
+            codepoint = 0;
+            for(int k = 0; k < 4; ++k)
+            {
+                int8_t val = helper_functions<buffer_type_, char_type_>::hexdigit_val(cur[k]);
+                if(val == -1)
+                    return false;
+                codepoint = (codepoint << 4) + static_cast<std::uint32_t>(val);
+            }
+            cur += 4;
+            return true;
+        };
+        std::uint32_t codepoint;
+        if(!read_hex4(codepoint))
+            return make_error("Invalid token in unicode escape");
+        if(codepoint >= 0xD800 && codepoint < 0xDFFF) // utf16 pair, special care needed
+        {
+            std::uint32_t low;
+            if(last - cur < 2 || !token_helper<char_type_>::is_token_backslash(cur[0]) ||
+                    !token_helper<char_type_>::is_token_char_u(cur[1]))
+                return make_error("Invalid token, expected low surrogate");
+            cur += 2;
+            if(!read_hex4(low))
+                return make_error("Invalid token in unicode escape");
+            if(low < 0xDC00u || low > 0xDFFFu)
+                return make_error("Invalid unicode code point");
+            codepoint = ((codepoint - 0xD800) << 10) + (low - 0xDC00) + 0x10000;
+        }
+        helper_functions<buffer_type_, char_type_>::truncate(lastValue_);
+        helper_functions<buffer_type_, char_type_>::append_code_point(lastValue_, codepoint);
+        return emit_content_(lastValue_.data(), lastValue_.size(), is_key);
+    }
+    else
+        return make_error("Invalid token in StringEscape");
+    return emit_content_(&value, 1, is_key);
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::number_(char_type_* first, char_type_* last)
+{
+    // json grammar : -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    auto is_digit = [](char_type_ c) {
+        return token_helper<char_type_>::is_token_zero(c) || token_helper<char_type_>::is_token_digit19(c);
+    };
+    char_type_* cur = first;
+    bool integral = true;
+    if(cur != last && token_helper<char_type_>::is_token_minussign(*cur))
+        ++cur;
+    if(cur == last)
+        return make_error("Invalid numeric format");
+    if(token_helper<char_type_>::is_token_zero(*cur))
+        ++cur;
+    else
+    {
+        if(!token_helper<char_type_>::is_token_digit19(*cur))
+            return make_error("Invalid numeric format");
+        while(cur != last && is_digit(*cur))
+            ++cur;
+    }
+    if(cur != last && token_helper<char_type_>::is_token_point(*cur))
+    {
+        integral = false;
+        ++cur;
+        if(cur == last || !is_digit(*cur))
+            return make_error("Invalid numeric format");
+        while(cur != last && is_digit(*cur))
+            ++cur;
+    }
+    if(cur != last && (token_helper<char_type_>::is_token_char_e(*cur) || token_helper<char_type_>::is_token_char_E(*cur)))
+    {
+        integral = false;
+        ++cur;
+        if(cur != last && (token_helper<char_type_>::is_token_plussign(*cur) || token_helper<char_type_>::is_token_minussign(*cur)))
+            ++cur;
+        if(cur == last || !is_digit(*cur))
+            return make_error("Invalid numeric format");
+        while(cur != last && is_digit(*cur))
+            ++cur;
+    }
+    if(cur != last)
+        return make_error("Invalid numeric format");
+    if constexpr(has_exact_integer_handler<parser_callbacks>::value)
+    {
+        if(integral)
+        {
+            auto magnitude = helper_functions<buffer_type_, char_type_>::chars_to_magnitude(first, last);
+            if(magnitude.first)
+                return parser_callbacks::exact_integer_handler(token_helper<char_type_>::is_token_minussign(*first),
+                                                               magnitude.second) ||
+                        make_error("exact_integer_handler failed");
+        }
+    }
+#ifdef JSON_USE_LONG_INTEGERS
+    if(integral)
+    {
+        auto val = helper_functions<buffer_type_, char_type_>::chars_to_integer(first, last);
+        if(val.first)
+            return parser_callbacks::integer_handler(val.second) || make_error("integer_handler failed");
+    }
+#else
+    (void)integral;
+#endif
+    auto val = helper_functions<buffer_type_, char_type_>::chars_to_double(first, last);
+    if(!val.first)
+        return make_error("Invalid double value");
+    return parser_callbacks::double_handler(val.second) || make_error("double_handler failed");
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::is_scalar_end_(char_type_ c)
+{
+    return token_helper<char_type_>::is_token_space(c) ||
+            token_helper<char_type_>::is_token_comma(c) ||
+            token_helper<char_type_>::is_token_colon(c) ||
+            token_helper<char_type_>::is_token_closing_square_bracket(c) ||
+            token_helper<char_type_>::is_token_closing_curly_bracket(c) ||
+            token_helper<char_type_>::is_token_opening_square_bracket(c) ||
+            token_helper<char_type_>::is_token_opening_curly_bracket(c) ||
+            token_helper<char_type_>::is_token_double_quote(c);
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container,parser_callbacks, buffer_type_, char_type_>::complete_without_error() const
+{
+    return complete_ && !error_;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+bool structural_parser<container, parser_callbacks, buffer_type_, char_type_>::make_error(char const* err)
+{
+    error_ = true;
+    err_ = err;
+    return false;
+}
+
+template<template<class> class container,
+typename parser_callbacks,typename buffer_type_, typename char_type_>
+char const * structural_parser<container, parser_callbacks, buffer_type_, char_type_>::error_message() const
+{
+    return err_;
+}
+
+}
+}
+
+#endif // JBC_JSON_STRUCTURAL_PARSER_H
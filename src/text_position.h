@@ -0,0 +1,54 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_TEXT_POSITION_H
+#define JBC_JSON_TEXT_POSITION_H
+
+#include <algorithm>
+#include <cstddef>
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * @brief The text_position struct locates a character inside a document
+ */
+struct text_position
+{
+    std::size_t offset = 0; /**< offset from the start of the document, in characters */
+    std::size_t line = 1; /**< line number, starting at 1 */
+    std::size_t column = 1; /**< column number inside the line, starting at 1, in characters */
+};
+
+/**
+ * @brief locate computes the line and column of the character at offset inside the document [begin, end). The
+ * lines are counted by scanning the document up to offset : it is meant to be done once, after an error, so
+ * that parsing itself never counts lines.
+ */
+template<typename char_type>
+text_position locate(char_type const* begin, char_type const* end, std::size_t offset)
+{
+    text_position position;
+    position.offset = offset;
+    char_type const* const target = begin + std::min(offset, static_cast<std::size_t>(end - begin));
+    char_type const* line_start = begin;
+    for(char_type const* cur = begin; cur != target; ++cur)
+    {
+        if(*cur == '\n')
+        {
+            ++position.line;
+            line_start = cur + 1;
+        }
+    }
+    position.column = static_cast<std::size_t>(target - line_start) + 1;
+    return position;
+}
+
+}
+}
+
+#endif // JBC_JSON_TEXT_POSITION_H
@@ -0,0 +1,307 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_UTF8_VALIDATOR_H
+#define JBC_JSON_UTF8_VALIDATOR_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * The utf8_validator class validates UTF-8 incrementally : input can be given in several parts, which may split
+ * a multibyte character anywhere. Overlong encodings, surrogates, code points above U+10FFFF, and misplaced or
+ * missing continuation bytes are rejected.
+ *
+ * Blocks of 32 (AVX2) or 16 (SSSE3) bytes are checked with the lookup algorithm of Keiser and Lemire, which
+ * classifies each pair of consecutive bytes with three table lookups. Ascii blocks only check that the previous
+ * block did not end in the middle of a character. The remaining bytes, and the bytes of a character split across
+ * parts, go through a scalar state machine, which also locates the first invalid byte.
+ */
+class utf8_validator
+{
+    std::uint8_t need_ = 0; // continuation bytes still expected
+    std::uint8_t lo_ = 0x80; // range of the next continuation byte
+    std::uint8_t hi_ = 0xBF;
+
+    bool step_(unsigned char c);
+    unsigned char const* validate_scalar_(unsigned char const* begin, unsigned char const* end);
+#if defined(__AVX2__) || defined(__SSSE3__)
+    /**
+     * @brief skip_blocks_ checks the whole blocks starting at begin, which must be at a character boundary
+     * @return where scalar validation must go on : after the last complete character, or begin if a block is
+     * invalid, so that the error is located by the scalar state machine
+     */
+    static unsigned char const* skip_blocks_(unsigned char const* begin, unsigned char const* end);
+#endif
+
+public:
+    /**
+     * @brief validate validates [begin, end), following the previous calls
+     * @return end if no invalid byte was found (the last character may be incomplete), else the first invalid byte
+     */
+    template<typename char_type>
+    char_type* validate(char_type* begin, char_type* end);
+    /**
+     * @brief validate validates a single byte, following the previous calls
+     */
+    bool validate(unsigned char c);
+    /**
+     * @brief complete tells whether the bytes validated so far end at a character boundary
+     */
+    bool complete() const;
+    void reset();
+};
+
+inline bool utf8_validator::step_(unsigned char c)
+{
+    if(need_ == 0)
+    {
+        if(c < 0x80)
+            return true;
+        if(c < 0xC2) // continuation byte, or overlong two bytes character
+            return false;
+        if(c < 0xE0)
+        {
+            need_ = 1;
+            return true;
+        }
+        if(c < 0xF0)
+        {
+            need_ = 2;
+            lo_ = c == 0xE0 ? 0xA0 : 0x80; // overlong
+            hi_ = c == 0xED ? 0x9F : 0xBF; // surrogate
+            return true;
+        }
+        if(c < 0xF5)
+        {
+            need_ = 3;
+            lo_ = c == 0xF0 ? 0x90 : 0x80; // overlong
+            hi_ = c == 0xF4 ? 0x8F : 0xBF; // above U+10FFFF
+            return true;
+        }
+        return false;
+    }
+    if(c < lo_ || c > hi_)
+        return false;
+    --need_;
+    lo_ = 0x80;
+    hi_ = 0xBF;
+    return true;
+}
+
+inline unsigned char const* utf8_validator::validate_scalar_(unsigned char const* begin, unsigned char const* end)
+{
+    unsigned char const* cur = begin;
+    while(cur != end)
+    {
+        if(need_ == 0)
+        {
+            while(end - cur >= 8) // ascii, a word at a time
+            {
+                std::uint64_t word;
+                std::memcpy(&word, cur, sizeof(word));
+                if((word & 0x8080808080808080ull) != 0)
+                    break;
+                cur += 8;
+            }
+            if(cur == end)
+                break;
+        }
+        if(!step_(*cur))
+            return cur;
+        ++cur;
+    }
+    return end;
+}
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+namespace utf8_validator_detail
+{
+// error bits of the lookup tables, for a pair of consecutive bytes
+constexpr char too_short = 1 << 0; // lead byte or ascii after a lead byte
+constexpr char too_long = 1 << 1; // continuation byte after an ascii byte
+constexpr char overlong_3 = 1 << 2;
+constexpr char too_large = 1 << 3;
+constexpr char surrogate = 1 << 4;
+constexpr char overlong_2 = 1 << 5;
+constexpr char too_large_1000 = 1 << 6;
+constexpr char overlong_4 = 1 << 6;
+constexpr char two_conts = static_cast<char>(1 << 7); // two continuation bytes, valid only in 3 and 4 bytes characters
+constexpr char carry = too_short | too_long | two_conts;
+}
+
+#define JBC_JSON_UTF8_BYTE_1_HIGH \
+    too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long, \
+    two_conts, two_conts, two_conts, two_conts, \
+    too_short | overlong_2, too_short, too_short | overlong_3 | surrogate, \
+    too_short | too_large | too_large_1000 | overlong_4
+#define JBC_JSON_UTF8_BYTE_1_LOW \
+    carry | overlong_3 | overlong_2 | overlong_4, carry | overlong_2, carry, carry, carry | too_large, \
+    carry | too_large | too_large_1000, carry | too_large | too_large_1000, carry | too_large | too_large_1000, \
+    carry | too_large | too_large_1000, carry | too_large | too_large_1000, carry | too_large | too_large_1000, \
+    carry | too_large | too_large_1000, carry | too_large | too_large_1000, \
+    carry | too_large | too_large_1000 | surrogate, carry | too_large | too_large_1000, \
+    carry | too_large | too_large_1000
+#define JBC_JSON_UTF8_BYTE_2_HIGH \
+    too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short, \
+    too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4, \
+    too_long | overlong_2 | two_conts | overlong_3 | too_large, \
+    too_long | overlong_2 | two_conts | surrogate | too_large, \
+    too_long | overlong_2 | two_conts | surrogate | too_large, \
+    too_short, too_short, too_short, too_short
+
+inline unsigned char const* utf8_validator::skip_blocks_(unsigned char const* begin, unsigned char const* end)
+{
+    using namespace utf8_validator_detail;
+    unsigned char const* cur = begin;
+#if defined(__AVX2__)
+    constexpr std::ptrdiff_t block = 32;
+    __m256i const byte_1_high = _mm256_setr_epi8(JBC_JSON_UTF8_BYTE_1_HIGH, JBC_JSON_UTF8_BYTE_1_HIGH);
+    __m256i const byte_1_low = _mm256_setr_epi8(JBC_JSON_UTF8_BYTE_1_LOW, JBC_JSON_UTF8_BYTE_1_LOW);
+    __m256i const byte_2_high = _mm256_setr_epi8(JBC_JSON_UTF8_BYTE_2_HIGH, JBC_JSON_UTF8_BYTE_2_HIGH);
+    __m256i const low_nibble = _mm256_set1_epi8(0x0F);
+    __m256i const max_value = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1),
+                                               static_cast<char>(0xC0 - 1));
+    __m256i prev = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    while(end - cur >= block)
+    {
+        __m256i input = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(cur));
+        if(_mm256_movemask_epi8(input) == 0) // ascii : the previous block must end with a complete character
+            error = _mm256_or_si256(error, _mm256_subs_epu8(prev, max_value));
+        else
+        {
+            __m256i shifted = _mm256_permute2x128_si256(prev, input, 0x21);
+            __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+            __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+            __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+            __m256i special = _mm256_and_si256(
+                        _mm256_and_si256(
+                            _mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble)),
+                            _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, low_nibble))),
+                        _mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble)));
+            __m256i must_be_continuation = _mm256_and_si256(
+                        _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80))),
+                                        _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)))),
+                        _mm256_set1_epi8(static_cast<char>(0x80)));
+            error = _mm256_or_si256(error, _mm256_xor_si256(must_be_continuation, special));
+        }
+        prev = input;
+        cur += block;
+    }
+    if(!_mm256_testz_si256(error, error))
+        return begin;
+#else
+    constexpr std::ptrdiff_t block = 16;
+    __m128i const byte_1_high = _mm_setr_epi8(JBC_JSON_UTF8_BYTE_1_HIGH);
+    __m128i const byte_1_low = _mm_setr_epi8(JBC_JSON_UTF8_BYTE_1_LOW);
+    __m128i const byte_2_high = _mm_setr_epi8(JBC_JSON_UTF8_BYTE_2_HIGH);
+    __m128i const low_nibble = _mm_set1_epi8(0x0F);
+    __m128i const max_value = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1),
+                                            static_cast<char>(0xC0 - 1));
+    __m128i prev = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
+    while(end - cur >= block)
+    {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<__m128i const*>(cur));
+        if(_mm_movemask_epi8(input) == 0) // ascii : the previous block must end with a complete character
+            error = _mm_or_si128(error, _mm_subs_epu8(prev, max_value));
+        else
+        {
+            __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+            __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+            __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+            __m128i special = _mm_and_si128(
+                        _mm_and_si128(
+                            _mm_shuffle_epi8(byte_1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble)),
+                            _mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, low_nibble))),
+                        _mm_shuffle_epi8(byte_2_high, _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble)));
+            __m128i must_be_continuation = _mm_and_si128(
+                        _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80))),
+                                     _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)))),
+                        _mm_set1_epi8(static_cast<char>(0x80)));
+            error = _mm_or_si128(error, _mm_xor_si128(must_be_continuation, special));
+        }
+        prev = input;
+        cur += block;
+    }
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xFFFF)
+        return begin;
+#endif
+    // the last block may end in the middle of a character, which is left to the scalar state machine
+    for(std::ptrdiff_t i = 1; i <= 3 && i <= cur - begin; ++i)
+    {
+        unsigned char c = *(cur - i);
+        if(c < 0x80)
+            break;
+        if(c >= 0xC0)
+        {
+            std::ptrdiff_t const length = c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : 2);
+            if(length > i)
+                cur -= i;
+            break;
+        }
+    }
+    return cur;
+}
+
+#undef JBC_JSON_UTF8_BYTE_1_HIGH
+#undef JBC_JSON_UTF8_BYTE_1_LOW
+#undef JBC_JSON_UTF8_BYTE_2_HIGH
+#endif
+
+template<typename char_type>
+char_type* utf8_validator::validate(char_type* begin, char_type* end)
+{
+    static_assert(sizeof(char_type) == 1, "utf8_validator only validates single byte characters");
+    unsigned char const* first = reinterpret_cast<unsigned char const*>(begin);
+    unsigned char const* last = reinterpret_cast<unsigned char const*>(end);
+    unsigned char const* cur = first;
+    for(; need_ != 0 && cur != last; ++cur) // end of a character started by a previous call
+    {
+        if(!step_(*cur))
+            return begin + (cur - first);
+    }
+#if defined(__AVX2__) || defined(__SSSE3__)
+    cur = skip_blocks_(cur, last);
+#endif
+    return begin + (validate_scalar_(cur, last) - first);
+}
+
+inline bool utf8_validator::validate(unsigned char c)
+{
+    return step_(c);
+}
+
+inline bool utf8_validator::complete() const
+{
+    return need_ == 0;
+}
+
+inline void utf8_validator::reset()
+{
+    need_ = 0;
+    lo_ = 0x80;
+    hi_ = 0xBF;
+}
+
+}
+}
+
+#endif // JBC_JSON_UTF8_VALIDATOR_H
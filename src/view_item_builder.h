@@ -0,0 +1,110 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JBC_JSON_VIEW_ITEM_BUILDER_H
+#define JBC_JSON_VIEW_ITEM_BUILDER_H
+
+#include "item_builder.h"
+
+namespace jbc
+{
+namespace json
+{
+
+/**
+ * The view_item_builder class builds items whose strings and keys are views (string_type is a view type, such
+ * as std::string_view), pointing into the parsed buffer instead of owning their data. It must be used with
+ * an in situ parser, on a document given in a single buffer, so that every string is reported as one view
+ * into that buffer. The buffer must outlive the built item.
+ *
+ * Any string part that is not inside the buffer given to set_buffer (such as data decoded by the parser in
+ * its own storage), or that is not contiguous with the previous part of the same string, is rejected.
+ */
+template<template<class> class container, typename Item_>
+class view_item_builder : public item_builder<container, Item_>
+{
+    using base = item_builder<container, Item_>;
+    using char_type = typename Item_::traits::char_type;
+    using string_type = typename Item_::traits::string_type;
+    using string_view = typename Item_::traits::string_view;
+
+    char_type const* buffer_begin_ = nullptr;
+    char_type const* buffer_end_ = nullptr;
+
+    bool append_view_(string_type& dest, string_view value) const;
+
+protected:
+    // STRING
+    bool string_content_handler(string_view value);
+
+    // KEY
+    bool begin_key_handler();
+    bool key_content_handler(string_view value);
+    bool end_key_handler();
+
+public:
+    /**
+     * @brief set_buffer sets the buffer the parsed document lies in. Views outside this buffer are rejected.
+     */
+    void set_buffer(char_type const* begin, char_type const* end);
+};
+
+template<template<class> class container,typename Item_>
+void view_item_builder<container, Item_>::set_buffer(char_type const* begin, char_type const* end)
+{
+    buffer_begin_ = begin;
+    buffer_end_ = end;
+}
+
+template<template<class> class container,typename Item_>
+bool view_item_builder<container, Item_>::append_view_(string_type& dest, string_view value) const
+{
+    if(value.data() < buffer_begin_ || value.data() + value.size() > buffer_end_)
+        return false;
+    if(dest.empty())
+    {
+        dest = string_type(value.data(), value.size());
+        return true;
+    }
+    if(dest.data() + dest.size() != value.data())
+        return false;
+    dest = string_type(dest.data(), dest.size() + value.size());
+    return true;
+}
+
+template<template<class> class container,typename Item_>
+bool view_item_builder<container, Item_>::string_content_handler(string_view value)
+{
+    return append_view_(base::current_item_.back()->string_value(), value);
+}
+
+template<template<class> class container,typename Item_>
+bool view_item_builder<container, Item_>::begin_key_handler()
+{
+    base::lastString_ = string_type{};
+    return true;
+}
+
+template<template<class> class container,typename Item_>
+bool view_item_builder<container, Item_>::key_content_handler(string_view value)
+{
+    return append_view_(base::lastString_, value);
+}
+
+template<template<class> class container,typename Item_>
+bool view_item_builder<container, Item_>::end_key_handler()
+{
+    if(!base::add_dom_bytes_(sizeof(typename Item_::traits::object_type::value_type)))
+        return false;
+    Item_* item = base::current_item_.back()->create_property(std::move(base::lastString_));
+    base::current_item_.push_back(item);
+    base::lastString_ = string_type{};
+    return true;
+}
+
+}
+}
+
+#endif // JBC_JSON_VIEW_ITEM_BUILDER_H
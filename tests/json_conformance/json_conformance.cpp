@@ -4,6 +4,17 @@
 //          https://www.boost.org/LICENSE_1_0.txt)
 
 #include <stl_json.h>
+#include <ndjson_reader.h>
+#include <parallel_parser.h>
+#include <pull_reader.h>
+#include <lazy_document.h>
+#include <read_pipeline.h>
+#include <static_json.h>
+#include <utf8_validator.h>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
 
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE json_conformance
@@ -11,6 +22,48 @@
 
 namespace utf = boost::unit_test;
 
+namespace
+{
+/**
+ * @brief chunk_sizes are the buffer sizes the incremental parsers are tested with
+ */
+std::size_t const chunk_sizes[] = {1, 2, 3, 7, 1000};
+
+/**
+ * @brief feed_chunks gives buf to feed(begin, end) in parts, and stops at the first part that feed rejects. The
+ * first part ends at first_part (chunk by default), the next ones are chunk characters long.
+ * @return false if feed rejected a part
+ */
+template<typename feed_type>
+bool feed_chunks(std::vector<char>& buf, std::size_t chunk, feed_type&& feed,
+                 std::size_t first_part = static_cast<std::size_t>(-1))
+{
+    std::size_t pos = std::min(first_part == static_cast<std::size_t>(-1) ? chunk : first_part, buf.size());
+    bool good = feed(buf.data(), buf.data() + pos);
+    for(; good && pos < buf.size(); pos += chunk)
+        good = feed(buf.data() + pos, buf.data() + std::min(buf.size(), pos + chunk));
+    return good;
+}
+
+/**
+ * @brief consume_chunks gives buf to parser.consume in parts, see feed_chunks, then ends the parsing
+ */
+template<typename parser_type>
+bool consume_chunks(parser_type& parser, std::vector<char>& buf, std::size_t chunk,
+                    std::size_t first_part = static_cast<std::size_t>(-1))
+{
+    return feed_chunks(buf, chunk, [&parser](char* begin, char* end) { return parser.consume(begin, end); },
+                       first_part) && parser.end();
+}
+
+template<typename parser_type>
+bool consume_chunks(parser_type& parser, std::string const& str, std::size_t chunk)
+{
+    std::vector<char> buf{str.begin(), str.end()};
+    return consume_chunks(parser, buf, chunk);
+}
+}
+
 BOOST_AUTO_TEST_CASE(pass0, *utf::description("Simple document"))
 {
     std::string str = "[{\"toto\":\"tutu\"},{\"toto\":\"tutu\"}]";
@@ -482,3 +535,1309 @@ BOOST_AUTO_TEST_CASE(parse_single_document, *utf::description("Parsing a string
     BOOST_TEST(prop->child_count() == 5);
     BOOST_TEST(!prop->item(2)->bool_value());
 }
+
+BOOST_AUTO_TEST_CASE(longstrings, *utf::description("Long strings and keys, with escapes, shall be read entirely"))
+{
+    std::string value(1000, 'a');
+    value += "\\n\\\"";
+    value += std::string(70, 'b');
+    std::string key(50, 'k');
+    std::string str = "{\"" + key + "\\t" + key + "\":\"" + value + "\"}";
+    std::istringstream s(str);
+    jbc::json::stl_item i;
+    bool res = parse_from_stream(s, i);
+    BOOST_TEST(res);
+    auto prop = i.property(key + "\t" + key);
+    BOOST_TEST(prop != nullptr);
+    BOOST_TEST(prop->string_value() == std::string(1000, 'a') + "\n\"" + std::string(70, 'b'));
+}
+
+BOOST_AUTO_TEST_CASE(chunkedstrings, *utf::description("Strings split at any position across buffers shall be read identically"))
+{
+    std::string str = R"json({"first key":"a rather long string value, with \"escapes\" and é", "k":["x", "yz"]})json";
+    for(size_t split = 0; split <= str.size(); ++split)
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        jbc::json::stl_parser parser;
+        bool res = consume_chunks(parser, buf, buf.size(), split);
+        BOOST_TEST(res);
+        jbc::json::stl_item i;
+        parser.moveTo(i);
+        BOOST_TEST(i.property("first key")->string_value() == u8"a rather long string value, with \"escapes\" and é");
+        BOOST_TEST(i.property("k")->item(1)->string_value() == "yz");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(function_table_engine, *utf::description("The function table engine shall build the same item as the default engine"))
+{
+    std::string str = R"json({"a" : [1, -2.5e3, true, false, null, "téxt"], "b" : {"c" : {}}})json";
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::function_table_parser_bits<jbc::json::stdvector, jbc::json::stl_item_builder, std::vector<char>, char> parser;
+    bool res = parser.consume(buf.data(), buf.data() + buf.size()) && parser.end();
+    BOOST_TEST(res);
+    jbc::json::stl_item i;
+    parser.moveTo(i);
+    BOOST_TEST(i.property("a")->child_count() == 6);
+    BOOST_TEST(i.property("a")->item(1)->double_value() == -2500.);
+    BOOST_TEST(i.property("a")->item(5)->string_value() == u8"téxt");
+    BOOST_TEST(i.property("b")->property("c")->child_count() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(structural_parser, *utf::description("The structural parser shall build the same item as the default engine"))
+{
+    std::string str = R"json({"a" : [1, -2.5e3, true, false, null, "t\u00e9xt\ud834\udd1e"],
+        "b" : {"c" : {}, "d" : []}, "long" : ")json" + std::string(200, 'x') + R"json(\\\"\n"})json";
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::stl_item i;
+    bool res = jbc::json::parse_from_buffer(buf.data(), buf.data() + buf.size(), i);
+    BOOST_TEST(res);
+    BOOST_TEST(i.property("a")->child_count() == 6);
+    BOOST_TEST(i.property("a")->item(0)->double_value() == 1.);
+    BOOST_TEST(i.property("a")->item(1)->double_value() == -2500.);
+    BOOST_TEST(i.property("a")->item(2)->bool_value());
+    BOOST_TEST((i.property("a")->item(4)->type() == jbc::json::ItemType::Null));
+    BOOST_TEST(i.property("a")->item(5)->string_value() == u8"téxt\U0001D11E");
+    BOOST_TEST(i.property("b")->property("c")->child_count() == 0);
+    BOOST_TEST(i.property("b")->property("d")->child_count() == 0);
+    BOOST_TEST(i.property("long")->string_value() == std::string(200, 'x') + "\\\"\n");
+}
+
+BOOST_AUTO_TEST_CASE(structural_parser_errors, *utf::description("The structural parser shall reject invalid documents"))
+{
+    for(std::string str : {"", "1", "[1,]", "[01]", "[1.]", "{\"a\" 1}", "{\"a\":1,}", "[tru]", "[truex]",
+                           "[\"abc]", "[\"a\tb\"]", "[1] [2]", "[[1]", "{\"a\":1]", "[\"\\x\"]",
+                           "[\"\\ud834\\uedd1\"]", "[\"\\ud834\\uffff\"]"})
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        jbc::json::stl_structural_parser parser;
+        BOOST_TEST(!parser.parse(buf.data(), buf.data() + buf.size()), str);
+        BOOST_TEST(parser.error_message() != nullptr);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(structural_list, *utf::description("The structural parser shall parse a list of values as the elements of an array"))
+{
+    std::string str = " 1, \"a\" ,{\"b\":[2]},\n[true], null ";
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::stl_structural_parser parser;
+    BOOST_TEST(parser.parse_list(buf.data(), buf.data() + buf.size()));
+    jbc::json::stl_item i;
+    parser.moveTo(i);
+    BOOST_TEST((i.type() == jbc::json::ItemType::Array));
+    BOOST_TEST(i.child_count() == 5);
+    BOOST_TEST(i.item(0)->double_value() == 1.);
+    BOOST_TEST(i.item(1)->string_value() == "a");
+    BOOST_TEST(i.item(2)->property("b")->child_count() == 1);
+    BOOST_TEST(i.item(3)->item(0)->bool_value());
+    BOOST_TEST((i.item(4)->type() == jbc::json::ItemType::Null));
+    parser.reset();
+    BOOST_TEST(parser.parse_list(buf.data(), buf.data()));
+    parser.moveTo(i);
+    BOOST_TEST(i.child_count() == 0);
+    for(std::string invalid : {"1,", ",1", "1]", "[1]]", "1 2", "1,,2", "]", "[1", "{\"a\":1}]", "1:2"})
+    {
+        std::vector<char> bad{invalid.begin(), invalid.end()};
+        parser.reset();
+        BOOST_TEST(!parser.parse_list(bad.data(), bad.data() + bad.size()), invalid);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(chunkednumbers, *utf::description("Numbers split at any position across buffers shall be read identically"))
+{
+    std::string str = R"json({"coords":[48.8566,-2.3522e-3,0,0.5,1234567890,1E10]})json";
+    for(size_t split = 0; split <= str.size(); ++split)
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        jbc::json::stl_parser parser;
+        bool res = consume_chunks(parser, buf, buf.size(), split);
+        BOOST_TEST(res);
+        jbc::json::stl_item i;
+        parser.moveTo(i);
+        auto coords = i.property("coords");
+        BOOST_TEST(coords->child_count() == 6);
+        BOOST_TEST(coords->item(0)->double_value() == 48.8566);
+        BOOST_TEST(coords->item(1)->double_value() == -2.3522e-3);
+        BOOST_TEST(coords->item(2)->double_value() == 0.);
+        BOOST_TEST(coords->item(3)->double_value() == 0.5);
+        BOOST_TEST(coords->item(4)->double_value() == 1234567890.);
+        BOOST_TEST(coords->item(5)->double_value() == 1e10);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(chunkedliterals, *utf::description("Literals split at any position across buffers shall be read identically"))
+{
+    std::string str = R"json({"a":true,"b":false,"c":null,"d":[true,false,null,[false]]})json";
+    for(size_t split = 0; split <= str.size(); ++split)
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        jbc::json::stl_parser parser;
+        bool res = consume_chunks(parser, buf, buf.size(), split);
+        BOOST_TEST(res);
+        jbc::json::stl_item i;
+        parser.moveTo(i);
+        BOOST_TEST(i.property("a")->bool_value());
+        BOOST_TEST(!i.property("b")->bool_value());
+        BOOST_TEST((i.property("c")->type() == jbc::json::ItemType::Null));
+        BOOST_TEST(i.property("d")->child_count() == 4);
+        BOOST_TEST(i.property("d")->item(0)->bool_value());
+        BOOST_TEST(!i.property("d")->item(1)->bool_value());
+        BOOST_TEST((i.property("d")->item(2)->type() == jbc::json::ItemType::Null));
+        BOOST_TEST(!i.property("d")->item(3)->item(0)->bool_value());
+    }
+    for(std::string invalid : {"[tru ]", "[fals]", "[nul]", "[truefalse]", "{\"a\":nulll}", "[falsy]"})
+    {
+        std::vector<char> buf{invalid.begin(), invalid.end()};
+        jbc::json::stl_parser parser;
+        bool res = parser.consume(buf.data(), buf.data() + buf.size()) && parser.end();
+        BOOST_TEST(!res, invalid);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(chunkedescapes, *utf::description("Escape sequences split at any position across buffers shall be read identically"))
+{
+    std::string str = R"json({"k\u00e9y\ud834\udd1e":"\u041f\u0440\u0438\u0432\u0435\u0442, \"w\u00f6rld\"\n\t\/\\\ud83d\ude00!"})json";
+    std::string key = u8"kéy\U0001D11E";
+    std::string value = u8"Привет, \"wörld\"\n\t/\\\U0001F600!";
+    for(size_t split = 0; split <= str.size(); ++split)
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        jbc::json::stl_parser parser;
+        bool res = consume_chunks(parser, buf, buf.size(), split);
+        BOOST_TEST(res);
+        jbc::json::stl_item i;
+        parser.moveTo(i);
+        BOOST_TEST(i.child_count() == 1);
+        BOOST_TEST(i.property(key) != nullptr);
+        if(i.property(key) != nullptr)
+            BOOST_TEST(i.property(key)->string_value() == value);
+    }
+    std::istringstream s(str);
+    jbc::json::stl_item i;
+    BOOST_TEST(parse_one_document(s, i));
+    BOOST_TEST(i.property(key)->string_value() == value);
+    for(std::string invalid : {R"(["\u12G4"])", R"(["\ud834A"])", R"(["\ud834x"])", R"(["\q"])", R"(["\ud834\uedd1"])",
+                               R"(["\ud834\uffff"])"})
+    {
+        for(std::size_t chunk : chunk_sizes)
+        {
+            jbc::json::stl_parser parser;
+            BOOST_TEST(!consume_chunks(parser, invalid, chunk), invalid);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(insitu, *utf::description("In situ parsing shall decode strings in place, as single views into the buffer"))
+{
+    std::string str = R"json({"k\u00e9y" : ["plain", "esc\"aped\\ \ud834\udd1e \u00e9t\u00e9 end", ""], "n" : 1.5, "e\\" : {}})json";
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::stl_view_item i;
+    bool res = jbc::json::parse_in_situ(buf.data(), buf.data() + buf.size(), i);
+    BOOST_TEST(res);
+    auto arr = i.property(u8"kéy");
+    BOOST_TEST(arr != nullptr);
+    BOOST_TEST(arr->item(0)->string_value() == "plain");
+    BOOST_TEST(arr->item(1)->string_value() == u8"esc\"aped\\ \U0001D11E été end");
+    BOOST_TEST(arr->item(2)->string_value().empty());
+    auto view = arr->item(1)->string_value();
+    BOOST_TEST((view.data() > buf.data() && view.data() + view.size() < buf.data() + buf.size()));
+    BOOST_TEST(i.property("n")->double_value() == 1.5);
+    BOOST_TEST(i.property("e\\") != nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(insitu_split, *utf::description("In situ parsing of a split buffer shall report strings in parts"))
+{
+    std::string str = R"json(["a\u00e9b\tc", "\u00e9\u00e9"])json";
+    for(size_t split = 0; split <= str.size(); ++split)
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        jbc::json::stl_parser parser;
+        parser.set_in_situ(true);
+        bool res = consume_chunks(parser, buf, buf.size(), split);
+        BOOST_TEST(res);
+        jbc::json::stl_item i;
+        parser.moveTo(i);
+        BOOST_TEST(i.item(0)->string_value() == u8"aéb\tc");
+        BOOST_TEST(i.item(1)->string_value() == u8"éé");
+    }
+}
+
+namespace
+{
+struct CountingHandler
+{
+    int documents = 0;
+    int values = 0;
+    bool begin_array_handler() { return true; }
+    bool end_array_handler() { return true; }
+    bool begin_object_handler() { return true; }
+    bool end_object_handler() { return true; }
+    bool boolean_handler(bool) { ++values; return true; }
+    bool double_handler(double) { ++values; return true; }
+    bool integer_handler(int64_t) { ++values; return true; }
+    bool null_handler() { ++values; return true; }
+    bool begin_string_handler() { ++values; return true; }
+    bool string_content_handler(std::string_view) { return true; }
+    bool end_string_handler() { return true; }
+    bool begin_key_handler() { return true; }
+    bool key_content_handler(std::string_view) { return true; }
+    bool end_key_handler() { return true; }
+};
+}
+
+BOOST_AUTO_TEST_CASE(concatenated_documents, *utf::description("consume_document shall stop at the end of each document"))
+{
+    std::string str = "{\"a\":1}\n[true, \"x\"]\n \"str\"{\"b\":[null]}\n";
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::parser_bits<jbc::json::stdvector, CountingHandler, std::vector<char>, char> parser;
+    char* cur = buf.data();
+    char* end = buf.data() + buf.size();
+    int documents = 0;
+    std::vector<std::size_t> sizes;
+    while(cur != end)
+    {
+        auto res = parser.consume_document(cur, end);
+        BOOST_TEST(res.first);
+        cur += res.second;
+        if(parser.complete_without_error())
+        {
+            ++documents;
+            sizes.push_back(res.second);
+            parser.reset();
+        }
+    }
+    BOOST_TEST(documents == 4);
+    BOOST_TEST(parser.values == 5);
+    BOOST_TEST((sizes == std::vector<std::size_t>{7, 12, 7, 12}));
+    auto res = parser.consume_document(cur, end); // only whitespace left
+    BOOST_TEST(res.first);
+    BOOST_TEST(!parser.complete_without_error());
+}
+
+BOOST_AUTO_TEST_CASE(concatenated_documents_split, *utf::description("consume_document shall handle documents split across buffers"))
+{
+    std::string str = "[1,2]{\"k\":\"v\"}";
+    for(size_t split = 0; split <= str.size(); ++split)
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        jbc::json::stl_parser parser;
+        std::size_t used = 0;
+        bool res = feed_chunks(buf, buf.size(), [&parser, &buf, &used](char* begin, char* end) {
+            if(parser.complete_without_error())
+                return true;
+            auto part = parser.consume_document(begin, end);
+            used = static_cast<std::size_t>(begin - buf.data()) + part.second;
+            return part.first;
+        }, split);
+        BOOST_TEST(res);
+        BOOST_TEST(parser.complete_without_error());
+        BOOST_TEST(used == 5u);
+        jbc::json::stl_item i;
+        parser.moveTo(i);
+        BOOST_TEST(i.child_count() == 2);
+    }
+}
+
+namespace
+{
+std::string make_ndjson(int lines, int invalid_line = -1)
+{
+    std::string doc;
+    for(int i = 0; i < lines; ++i)
+    {
+        if(i == invalid_line)
+            doc += "{\"id\":" + std::to_string(i) + ",}\n";
+        else
+            doc += "{\"id\":" + std::to_string(i) + ",\"name\":\"line\\t" + std::to_string(i) + "\",\"v\":[true,null]}\n";
+    }
+    return doc;
+}
+}
+
+BOOST_AUTO_TEST_CASE(ndjson_ordered, *utf::description("The ndjson reader shall deliver every document in input order"))
+{
+    std::string str = make_ndjson(1000);
+    std::vector<char> buf{str.begin(), str.end() - 1}; // no line feed after the last document
+    jbc::json::ndjson_reader reader(3, 256);
+    std::vector<int> ids;
+    bool res = reader.parse(buf.data(), buf.data() + buf.size(), [&ids](jbc::json::stl_item&& i) {
+        ids.push_back(static_cast<int>(i.property("id")->double_value()));
+        return i.property("name")->string_value() == "line\t" + std::to_string(ids.back());
+    });
+    BOOST_TEST(res);
+    BOOST_TEST(reader.error_message() == nullptr);
+    BOOST_TEST(ids.size() == 1000u);
+    for(std::size_t i = 0; i < ids.size(); ++i)
+        BOOST_TEST(ids[i] == static_cast<int>(i));
+    std::istringstream s(str);
+    ids.clear();
+    res = reader.parse_stream(s, [&ids](jbc::json::stl_item&& i) {
+        ids.push_back(static_cast<int>(i.property("id")->double_value()));
+        return true;
+    });
+    BOOST_TEST(res);
+    BOOST_TEST(ids.size() == 1000u);
+    for(std::size_t i = 0; i < ids.size(); ++i)
+        BOOST_TEST(ids[i] == static_cast<int>(i));
+}
+
+BOOST_AUTO_TEST_CASE(ndjson_unordered, *utf::description("The unordered ndjson reader shall deliver every document once"))
+{
+    std::string str = make_ndjson(1000);
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::ndjson_reader reader(4, 100);
+    reader.set_ordered(false);
+    std::vector<int> ids;
+    bool res = reader.parse(buf.data(), buf.data() + buf.size(), [&ids](jbc::json::stl_item&& i) {
+        ids.push_back(static_cast<int>(i.property("id")->double_value()));
+        return true;
+    });
+    BOOST_TEST(res);
+    std::sort(ids.begin(), ids.end());
+    BOOST_TEST(ids.size() == 1000u);
+    for(std::size_t i = 0; i < ids.size(); ++i)
+        BOOST_TEST(ids[i] == static_cast<int>(i));
+}
+
+BOOST_AUTO_TEST_CASE(ndjson_errors, *utf::description("The ndjson reader shall stop at the first invalid document"))
+{
+    std::string str = make_ndjson(1000, 600);
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::ndjson_reader reader(2, 128);
+    int count = 0;
+    bool res = reader.parse(buf.data(), buf.data() + buf.size(), [&count](jbc::json::stl_item&&) {
+        ++count;
+        return true;
+    });
+    BOOST_TEST(!res);
+    BOOST_TEST(count == 600);
+    BOOST_TEST(reader.error_message() != nullptr);
+    BOOST_TEST(reader.error_offset() == str.find("{\"id\":600,"));
+    count = 0;
+    res = reader.parse(buf.data(), buf.data() + buf.size(), [&count](jbc::json::stl_item&&) {
+        return ++count < 10;
+    });
+    BOOST_TEST(!res);
+    BOOST_TEST(count == 10);
+    BOOST_TEST(reader.error_message() == nullptr);
+    std::string truncated = "{\"a\":1}\n{\"b\":";
+    std::vector<char> tbuf{truncated.begin(), truncated.end()};
+    res = reader.parse(tbuf.data(), tbuf.data() + tbuf.size(), [](jbc::json::stl_item&&) { return true; });
+    BOOST_TEST(!res);
+    BOOST_TEST(reader.error_offset() == 8u);
+    // a document spanning two lines fails the same way, wherever the chunks are cut
+    std::string const split_lines = "{\"a\":1}\n{\"b\":\n2}\n";
+    for(std::size_t chunk_size : {std::size_t(1), std::size_t(8), std::size_t(16), std::size_t(1000)})
+    {
+        jbc::json::ndjson_reader small_chunks(2, chunk_size);
+        std::vector<char> lbuf{split_lines.begin(), split_lines.end()};
+        count = 0;
+        auto counting = [&count](jbc::json::stl_item&&) { ++count; return true; };
+        BOOST_TEST(!small_chunks.parse(lbuf.data(), lbuf.data() + lbuf.size(), counting), chunk_size);
+        BOOST_TEST(count == 1);
+        BOOST_TEST(std::string(small_chunks.error_message()) == "Unexpected end of line");
+        BOOST_TEST(small_chunks.error_offset() == 8u);
+        std::istringstream stream(split_lines);
+        count = 0;
+        BOOST_TEST(!small_chunks.parse_stream(stream, counting), chunk_size);
+        BOOST_TEST(count == 1);
+        BOOST_TEST(std::string(small_chunks.error_message()) == "Unexpected end of line");
+        BOOST_TEST(small_chunks.error_offset() == 8u);
+    }
+    // a throwing callback leaves when the workers are done with the chunks, and the reader can be used again
+    count = 0;
+    BOOST_CHECK_THROW(reader.parse(buf.data(), buf.data() + buf.size(), [&count](jbc::json::stl_item&&) -> bool {
+        if(++count == 10)
+            throw std::runtime_error("callback failed");
+        return true;
+    }), std::runtime_error);
+    count = 0;
+    res = reader.parse(buf.data(), buf.data() + str.find("{\"id\":600,"), [&count](jbc::json::stl_item&&) {
+        ++count;
+        return true;
+    });
+    BOOST_TEST(res);
+    BOOST_TEST(count == 600);
+}
+
+namespace
+{
+bool same_item(jbc::json::stl_item const& a, jbc::json::stl_item const& b)
+{
+    using jbc::json::ItemType;
+    if(a.type() != b.type())
+        return false;
+    switch(a.type())
+    {
+    case ItemType::Boolean:
+        return a.bool_value() == b.bool_value();
+    case ItemType::Double:
+        return a.double_value() == b.double_value();
+    case ItemType::String:
+        return a.string_value() == b.string_value();
+    case ItemType::Array:
+        return std::equal(a.begin_array(), a.end_array(), b.begin_array(), b.end_array(), same_item);
+    case ItemType::Object:
+        return std::equal(a.begin_object(), a.end_object(), b.begin_object(), b.end_object(),
+                          [](auto const& x, auto const& y) { return x.first == y.first && same_item(x.second, y.second); });
+    default:
+        return true;
+    }
+}
+}
+
+BOOST_AUTO_TEST_CASE(parallel_parse, *utf::description("The parallel parser shall build the same item as the serial parser"))
+{
+    std::string str = "[ ";
+    for(int i = 0; i < 200; ++i)
+    {
+        if(i > 0)
+            str += i % 3 ? "," : ",\n  ";
+        str += "{\"id\":" + std::to_string(i) + ",\"s\":\"";
+        if(i % 7 == 0)
+            str += ",{\\\",[\\\\"; // string content looking like a record boundary, with escaped quote and backslash
+        str += "\",\"n\":[1,{\"a\":[]},[2]," + std::string(i % 5 == 0 ? "{\"b\":1}" : "3") + "]}";
+        if(i % 11 == 0)
+            str += ",[true,{\"c\":null}]";
+    }
+    str += "]\n";
+    std::vector<char> reference_buf{str.begin(), str.end()};
+    jbc::json::stl_item reference;
+    BOOST_TEST(jbc::json::parse_from_buffer(reference_buf.data(), reference_buf.data() + reference_buf.size(), reference));
+    for(unsigned int threads = 2; threads <= 5; ++threads)
+    {
+        for(std::size_t min_slice_size : {16u, 100u, 1000u})
+        {
+            std::vector<char> buf{str.begin(), str.end()};
+            jbc::json::stl_item i;
+            BOOST_TEST(jbc::json::parse_parallel(buf.data(), buf.data() + buf.size(), i, threads, min_slice_size));
+            BOOST_TEST(same_item(i, reference));
+        }
+    }
+    std::string invalid = str;
+    invalid.replace(invalid.find("\"id\":150"), 5, "\"id\"");
+    std::vector<char> buf{invalid.begin(), invalid.end()};
+    jbc::json::stl_item i;
+    BOOST_TEST(!jbc::json::parse_parallel(buf.data(), buf.data() + buf.size(), i, 4, 16));
+    // numbers that only the incremental parser accepted : the result must not depend on the split
+    for(std::string number : {"1.", "-.25e3", "-025e3", "-01"})
+    {
+        invalid = str;
+        invalid.replace(invalid.find("\"id\":150") + 5, 3, number);
+        std::vector<char> serial{invalid.begin(), invalid.end()};
+        bool const expected = jbc::json::parse_from_buffer(serial.data(), serial.data() + serial.size(), i);
+        BOOST_TEST(!expected);
+        for(unsigned int threads = 1; threads <= 4; ++threads)
+        {
+            std::vector<char> nbuf{invalid.begin(), invalid.end()};
+            BOOST_TEST(jbc::json::parse_parallel(nbuf.data(), nbuf.data() + nbuf.size(), i, threads, 16) == expected);
+        }
+    }
+    std::string object = "{\"a\":[{},{}]}";
+    std::vector<char> obuf{object.begin(), object.end()};
+    BOOST_TEST(jbc::json::parse_parallel(obuf.data(), obuf.data() + obuf.size(), i, 4, 1));
+    BOOST_TEST((i.type() == jbc::json::ItemType::Object));
+}
+
+BOOST_AUTO_TEST_CASE(parser_reuse, *utf::description("A reset parser shall build the next document from scratch"))
+{
+    std::string str1 = "[1,[2,{\"a\":\"b\"}]]";
+    std::string str2 = "{\"k\":[true]}";
+    std::vector<char> first{str1.begin(), str1.end()};
+    std::vector<char> second{str2.begin(), str2.end()};
+    jbc::json::stl_parser parser;
+    BOOST_TEST(parser.consume(first.data(), first.data() + first.size()));
+    parser.reset(); // discards the complete, not moved, first item
+    BOOST_TEST(parser.consume(second.data(), second.data() + second.size()));
+    BOOST_TEST(parser.end());
+    jbc::json::stl_item i;
+    parser.moveTo(i);
+    BOOST_TEST((i.type() == jbc::json::ItemType::Object));
+    BOOST_TEST(i.property("k")->child_count() == 1);
+    parser.reset();
+    BOOST_TEST(parser.consume(first.data(), first.data() + 7)); // stops inside the nested array
+    parser.reset();
+    BOOST_TEST(parser.consume(first.data(), first.data() + first.size()));
+    BOOST_TEST(parser.end());
+    parser.moveTo(i);
+    BOOST_TEST(i.child_count() == 2);
+    BOOST_TEST(i.item(1)->item(1)->property("a")->string_value() == "b");
+}
+
+BOOST_AUTO_TEST_CASE(helpers_reuse, *utf::description("The parse helpers shall not keep anything from a previous document"))
+{
+    jbc::json::stl_item i;
+    std::istringstream invalid("[{\"a\":[1,2");
+    BOOST_TEST(!parse_from_stream(invalid, i));
+    std::istringstream valid("[\"x\"]");
+    BOOST_TEST(parse_from_stream(valid, i));
+    BOOST_TEST(i.child_count() == 1);
+    BOOST_TEST(i.item(0)->string_value() == "x");
+    std::string str = "{\"a\":{\"b\":[]}}";
+    for(int n = 0; n < 3; ++n)
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        BOOST_TEST(jbc::json::parse_from_buffer(buf.data(), buf.data() + buf.size(), i));
+        BOOST_TEST(i.child_count() == 1);
+        BOOST_TEST(i.property("a")->property("b")->child_count() == 0);
+    }
+    // settings left on the parser of the thread are not kept either
+    jbc::json::parser_limits limits;
+    limits.max_depth = 1;
+    jbc::json::stl_json_detail::thread_local_parser<jbc::json::stl_parser>().set_limits(limits);
+    jbc::json::stl_json_detail::thread_local_parser<jbc::json::stl_parser>().set_utf8_validation(true);
+    std::istringstream nested("[[\"\xff\"]]");
+    BOOST_TEST(parse_from_stream(nested, i));
+    BOOST_TEST(i.item(0)->child_count() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(mapped_file, *utf::description("Regular files shall be memory mapped and parsed, other files read"))
+{
+    std::string path = (std::filesystem::temp_directory_path() / "jbc_json_mapped_file_test.json").string();
+    {
+        std::ofstream f(path, std::ios::binary);
+        f << "[{\"a\":\"" << std::string(100000, 'x') << "\"},\n true]\n";
+    }
+    {
+        jbc::json::mapped_file mapping(path, true);
+        BOOST_TEST(mapping.is_open());
+        BOOST_TEST(mapping.size() == 100018u);
+        BOOST_TEST(*mapping.begin() == '[');
+    }
+    jbc::json::stl_item i;
+    BOOST_TEST(jbc::json::parse_from_file(path, i));
+    BOOST_TEST(i.child_count() == 2);
+    BOOST_TEST(i.item(0)->property("a")->string_value().size() == 100000u);
+    {
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        f << "[1,";
+    }
+    BOOST_TEST(!jbc::json::parse_from_file(path, i));
+    {
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    }
+    BOOST_TEST(!jbc::json::mapped_file(path).is_open());
+    BOOST_TEST(!jbc::json::parse_from_file(path, i));
+    std::filesystem::remove(path);
+    BOOST_TEST(!jbc::json::mapped_file(path).is_open());
+    BOOST_TEST(!jbc::json::parse_from_file(path, i));
+#if defined(__unix__)
+    BOOST_TEST(!jbc::json::mapped_file("/dev/null").is_open());
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(pipelined_stream, *utf::description("The pipelined parse shall read the stream through a ring of buffers"))
+{
+    std::string str = "[{\"toto\":\"tutu\"},{\"toto\":[1,2,3]}, \"a long enough string\"]";
+    jbc::json::pipeline_options options;
+    options.buffer_count = 2;
+    options.buffer_size = 7;
+    jbc::json::pipeline_statistics statistics;
+    jbc::json::stl_item i;
+    std::istringstream s(str);
+    BOOST_TEST(jbc::json::parse_from_stream_pipelined(s, i, options, &statistics));
+    BOOST_TEST(i.child_count() == 3);
+    BOOST_TEST(i.item(2)->string_value() == "a long enough string");
+    BOOST_TEST(statistics.bytes == str.size());
+    BOOST_TEST(statistics.blocks == (str.size() + 6) / 7);
+    std::istringstream invalid("[1,2,]" + std::string(100000, ' '));
+    BOOST_TEST(!jbc::json::parse_from_stream_pipelined(invalid, i, options, &statistics));
+    BOOST_TEST(statistics.bytes < 100000u);
+    std::istringstream truncated("[1,2");
+    BOOST_TEST(!jbc::json::parse_from_stream_pipelined(truncated, i));
+    std::string path = (std::filesystem::temp_directory_path() / "jbc_json_pipelined_test.json").string();
+    {
+        std::ofstream f(path, std::ios::binary);
+        f << str;
+    }
+    BOOST_TEST(jbc::json::parse_from_file_pipelined(path, i, options));
+    BOOST_TEST(i.child_count() == 3);
+    std::filesystem::remove(path);
+    BOOST_TEST(!jbc::json::parse_from_file_pipelined(path, i));
+}
+
+namespace
+{
+struct RejectBooleans : CountingHandler
+{
+    bool boolean_handler(bool) { return false; }
+};
+
+struct RejectKeys : CountingHandler
+{
+    bool begin_key_handler() { return false; }
+};
+
+jbc::json::parse_error parse_with_limits(std::string const& str, jbc::json::parser_limits const& limits, std::size_t chunk)
+{
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::stl_parser parser;
+    parser.set_limits(limits);
+    bool const good = consume_chunks(parser, buf, chunk);
+    BOOST_TEST(good == (parser.error_code() == jbc::json::parse_error::none));
+    return parser.error_code();
+}
+}
+
+BOOST_AUTO_TEST_CASE(parser_limits, *utf::description("Resource limits shall fail parsing with a distinct error code"))
+{
+    using jbc::json::parse_error;
+    for(std::size_t chunk : chunk_sizes)
+    {
+        jbc::json::parser_limits limits;
+        limits.max_depth = 3;
+        BOOST_TEST((parse_with_limits("[[{\"a\":1}]]", limits, chunk) == parse_error::none));
+        limits.max_depth = 2;
+        BOOST_TEST((parse_with_limits("[[{\"a\":1}]]", limits, chunk) == parse_error::depth_limit));
+
+        limits = jbc::json::parser_limits();
+        limits.max_string_length = 4;
+        BOOST_TEST((parse_with_limits("{\"abcd\":[\"abcd\",\"ab\\u00e9\"]}", limits, chunk) == parse_error::none));
+        BOOST_TEST((parse_with_limits("[\"abcde\"]", limits, chunk) == parse_error::string_length_limit));
+        BOOST_TEST((parse_with_limits("[\"ab\\n\\tc\"]", limits, chunk) == parse_error::string_length_limit));
+        BOOST_TEST((parse_with_limits("{\"abcde\":1}", limits, chunk) == parse_error::string_length_limit));
+
+        limits = jbc::json::parser_limits();
+        limits.max_number_length = 5;
+        BOOST_TEST((parse_with_limits("[12345,-1.5]", limits, chunk) == parse_error::none));
+        BOOST_TEST((parse_with_limits("[123456]", limits, chunk) == parse_error::number_length_limit));
+        BOOST_TEST((parse_with_limits("{\"a\":1.2345e10}", limits, chunk) == parse_error::number_length_limit));
+
+        limits = jbc::json::parser_limits();
+        limits.max_element_count = 6;
+        BOOST_TEST((parse_with_limits("[1,[2,3],{\"a\":true}]", limits, chunk) == parse_error::none));
+        BOOST_TEST((parse_with_limits("[1,[2,3],{\"a\":true},null]", limits, chunk) == parse_error::element_count_limit));
+
+        limits = jbc::json::parser_limits();
+        limits.max_dom_bytes = 100000;
+        BOOST_TEST((parse_with_limits("[\"" + std::string(1000, 'x') + "\",{\"key\":[1,2,3]}]", limits, chunk) == parse_error::none));
+        BOOST_TEST((parse_with_limits("[\"" + std::string(100000, 'x') + "\"]", limits, chunk) == parse_error::dom_size_limit));
+        BOOST_TEST((parse_with_limits("[" + std::string(20000, '[') + std::string(20000, ']') + "]", limits, chunk) ==
+                    parse_error::dom_size_limit));
+        limits.max_dom_bytes = 2 * sizeof(jbc::json::stl_item);
+        BOOST_TEST((parse_with_limits("[1,2,3,4 ]", limits, chunk) == parse_error::dom_size_limit));
+
+        limits = jbc::json::parser_limits();
+        BOOST_TEST((parse_with_limits("[1,]", limits, chunk) == parse_error::syntax));
+        BOOST_TEST((parse_with_limits("[1", limits, chunk) == parse_error::syntax));
+    }
+    std::string str = "[1,true]";
+    jbc::json::parser_bits<jbc::json::stdvector, RejectBooleans, std::vector<char>, char> parser;
+    BOOST_TEST(!parser.consume(str.data(), str.data() + str.size()));
+    BOOST_TEST((parser.error_code() == parse_error::handler_failed));
+    parser.reset();
+    BOOST_TEST((parser.error_code() == parse_error::none));
+
+    // a handler failing on a number or a key stops the parsing, even when more characters follow
+    jbc::json::parser_limits limits;
+    limits.max_dom_bytes = 2 * sizeof(jbc::json::stl_item);
+    str = "[1,2,3,4 ]";
+    jbc::json::stl_parser limited;
+    limited.set_limits(limits);
+    BOOST_TEST(!limited.consume(str.data(), str.data() + str.size()));
+    BOOST_TEST((limited.error_code() == parse_error::dom_size_limit));
+    str = "{\"a\":1}";
+    jbc::json::parser_bits<jbc::json::stdvector, RejectKeys, std::vector<char>, char> keys;
+    BOOST_TEST(!keys.consume(str.data(), str.data() + str.size()));
+    BOOST_TEST((keys.error_code() == parse_error::handler_failed));
+}
+
+BOOST_AUTO_TEST_CASE(error_offset, *utf::description("The parser shall report the offset, line and column of the first error"))
+{
+    std::string str = "{\n  \"a\": [1, 2],\n  \"b\": [tru, 3]\n}\n";
+    std::size_t const expected = str.find("tru,") + 3;
+    for(std::size_t chunk : chunk_sizes)
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        jbc::json::stl_parser parser;
+        BOOST_TEST(parser.error_offset() == jbc::json::stl_parser::no_error_offset);
+        bool const good = feed_chunks(buf, chunk, [&parser](char* begin, char* end) {
+            return parser.consume(begin, end);
+        });
+        BOOST_TEST(!good);
+        BOOST_TEST(parser.error_offset() == expected);
+        jbc::json::text_position position = parser.error_position(buf.data(), buf.data() + buf.size());
+        BOOST_TEST(position.line == 3u);
+        BOOST_TEST(position.column == 12u);
+    }
+    std::string truncated = "[1,\n2";
+    std::vector<char> buf{truncated.begin(), truncated.end()};
+    jbc::json::stl_parser parser;
+    BOOST_TEST(parser.consume(buf.data(), buf.data() + buf.size()));
+    BOOST_TEST(!parser.end());
+    BOOST_TEST(parser.error_message() != nullptr);
+    BOOST_TEST(parser.error_offset() == truncated.size());
+    BOOST_TEST(parser.error_position(buf.data(), buf.data() + buf.size()).line == 2u);
+    BOOST_TEST(parser.error_position(buf.data(), buf.data() + buf.size()).column == 2u);
+    parser.reset();
+    BOOST_TEST(parser.error_offset() == jbc::json::stl_parser::no_error_offset);
+    std::string second = "[\"a\"]  [\"b\" 1]";
+    std::vector<char> sbuf{second.begin(), second.end()};
+    auto res = parser.consume_document(sbuf.data(), sbuf.data() + sbuf.size());
+    BOOST_TEST(res.first);
+    parser.reset();
+    res = parser.consume_document(sbuf.data() + res.second, sbuf.data() + sbuf.size());
+    BOOST_TEST(!res.first);
+    BOOST_TEST(parser.error_offset() == 7u); // relative to where the second call started
+}
+
+namespace
+{
+jbc::json::parse_error parse_validating(std::string const& str, std::size_t chunk, std::size_t* offset = nullptr)
+{
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::stl_parser parser;
+    parser.set_utf8_validation(true);
+    consume_chunks(parser, buf, chunk);
+    if(offset != nullptr)
+        *offset = parser.error_offset();
+    return parser.error_code();
+}
+}
+
+BOOST_AUTO_TEST_CASE(utf8_validation, *utf::description("Strings and keys shall be rejected if they are not valid UTF-8, when validation is enabled"))
+{
+    using jbc::json::parse_error;
+    std::string const padding(40, 'a'); // long enough for the simd blocks
+    std::string const valid[] = {"\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xEF\xBF\xBF", "\xF4\x8F\xBF\xBF",
+                                 "\xED\x9F\xBF", "\xE0\xA0\x80", "\xF0\x90\x80\x80"};
+    std::string const invalid[] = {"\x80", "\xBF", "\xC0\x80", "\xC1\xBF", "\xC3", "\xE0\x80\x80", "\xED\xA0\x80",
+                                   "\xE2\x82", "\xF0\x80\x80\x80", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF",
+                                   "\xC3\xA9\xA9", "\xE2\x82\xC3\xA9"};
+    for(std::size_t chunk : chunk_sizes)
+    {
+        for(std::string const& v : valid)
+        {
+            BOOST_TEST((parse_validating("[\"" + v + "\"]", chunk) == parse_error::none));
+            BOOST_TEST((parse_validating("{\"" + padding + v + padding + v + "\":\"" + v + padding + "\"}", chunk) == parse_error::none));
+            BOOST_TEST((parse_validating("[\"" + v + "\\n" + v + padding + v + padding + v + v + v + "\"]", chunk) == parse_error::none));
+        }
+        for(std::string const& i : invalid)
+        {
+            std::size_t offset = 0;
+            BOOST_TEST((parse_validating("[\"" + i + "\"]", chunk) == parse_error::invalid_utf8));
+            BOOST_TEST((parse_validating("[\"" + i + "\\n\"]", chunk) == parse_error::invalid_utf8));
+            BOOST_TEST((parse_validating("{\"" + padding + i + padding + "\":1}", chunk, &offset) == parse_error::invalid_utf8));
+            BOOST_TEST(offset >= 2 + padding.size());
+            BOOST_TEST(offset < 2 + padding.size() + i.size() + 1);
+        }
+    }
+    std::size_t offset = 0;
+    BOOST_TEST((parse_validating("[\"" + padding + "\xE0\xA0\x80\xE0\x80\x80" + padding + "\"]", 1000, &offset) == parse_error::invalid_utf8));
+    BOOST_TEST(offset == 2 + padding.size() + 4); // the first byte that cannot be part of a valid character
+    BOOST_TEST((parse_validating("[\"" + padding + "\xC3\"]", 1000, &offset) == parse_error::invalid_utf8));
+    BOOST_TEST(offset == 2 + padding.size() + 1); // the closing quote
+    // without validation, bytes are passed through
+    jbc::json::stl_item item;
+    std::string str = "[\"\xC0\x80\"]";
+    std::vector<char> buf{str.begin(), str.end()};
+    BOOST_TEST(jbc::json::parse_from_buffer(buf.data(), buf.data() + buf.size(), item));
+}
+
+BOOST_AUTO_TEST_CASE(utf8_validator, *utf::description("Block validation shall find the same first error as the byte by byte validation"))
+{
+    std::string const characters[] = {"a", "\"", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xED\x9F\xBF"};
+    std::string const noise[] = {"\x80", "\xC0", "\xE0", "\xED\xA0", "\xF4\x90", "\xF8"};
+    std::mt19937 random(42);
+    for(int iteration = 0; iteration < 2000; ++iteration)
+    {
+        std::string str;
+        std::size_t const length = random() % 200;
+        while(str.size() < length)
+            str += random() % 50 == 0 ? noise[random() % 6] : characters[random() % 6];
+        std::vector<char> buf{str.begin(), str.end()};
+        std::size_t expected = buf.size();
+        jbc::json::utf8_validator bytes;
+        for(std::size_t i = 0; i < buf.size(); ++i)
+        {
+            if(!bytes.validate(static_cast<unsigned char>(buf[i])))
+            {
+                expected = i;
+                break;
+            }
+        }
+        std::size_t const split = buf.empty() ? 0 : random() % buf.size();
+        jbc::json::utf8_validator blocks;
+        char* invalid = blocks.validate(buf.data(), buf.data() + split);
+        if(invalid == buf.data() + split)
+            invalid = blocks.validate(buf.data() + split, buf.data() + buf.size());
+        BOOST_TEST(static_cast<std::size_t>(invalid - buf.data()) == expected);
+        if(expected == buf.size())
+            BOOST_TEST(blocks.complete() == bytes.complete());
+    }
+}
+
+namespace
+{
+struct SkippingHandler
+{
+    std::string trace;
+    std::string key;
+    bool skip_arrays = false;
+    jbc::json::handler_result begin_array_handler()
+    {
+        trace += skip_arrays ? "[skipped]" : "[";
+        return skip_arrays ? jbc::json::handler_result::skip : jbc::json::handler_result::proceed;
+    }
+    bool end_array_handler() { trace += "]"; return true; }
+    bool begin_object_handler() { trace += "{"; return true; }
+    bool end_object_handler() { trace += "}"; return true; }
+    bool boolean_handler(bool value) { trace += value ? "t" : "f"; return true; }
+    bool double_handler(double) { trace += "#"; return true; }
+    bool integer_handler(int64_t) { trace += "#"; return true; }
+    bool null_handler() { trace += "n"; return true; }
+    bool begin_string_handler() { trace += "\""; return true; }
+    bool string_content_handler(std::string_view value) { trace += value; return true; }
+    bool end_string_handler() { trace += "\""; return true; }
+    bool begin_key_handler() { key.clear(); return true; }
+    bool key_content_handler(std::string_view value) { key += value; return true; }
+    jbc::json::handler_result end_key_handler()
+    {
+        trace += key + ":";
+        return key == "skip" ? jbc::json::handler_result::skip : jbc::json::handler_result::proceed;
+    }
+    void reset() { trace.clear(); }
+};
+
+template<typename parser_type>
+std::string skip_trace(std::string const& str, bool skip_arrays, std::size_t chunk)
+{
+    parser_type parser;
+    parser.skip_arrays = skip_arrays;
+    return consume_chunks(parser, str, chunk) ? parser.trace : "error";
+}
+
+std::string structural_skip_trace(std::string const& str, bool skip_arrays)
+{
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::structural_parser<jbc::json::stdvector, SkippingHandler, std::vector<char>, char> parser;
+    parser.skip_arrays = skip_arrays;
+    return parser.parse(buf.data(), buf.data() + buf.size()) ? parser.trace : "error";
+}
+}
+
+BOOST_AUTO_TEST_CASE(skip_value, *utf::description("Handlers shall be able to skip arrays, objects and the values of keys"))
+{
+    using bits = jbc::json::parser_bits<jbc::json::stdvector, SkippingHandler, std::vector<char>, char>;
+    using table = jbc::json::function_table_parser_bits<jbc::json::stdvector, SkippingHandler, std::vector<char>, char>;
+    std::string const str = "{\"a\":1,\"skip\":{\"x\":[1,\"]}\\\"\",{\"y\":2}],\"z\":\"}\"},\"b\":[true, null],"
+                            "\"skip\" : \"str\\\"ing]\",\"c\":-1.5e3,\"skip\":123,\"d\":\"x\",\"skip\":[],\"skip\":false}";
+    std::string const expected = "{a:#skip:b:[tn]skip:c:#skip:d:\"x\"skip:skip:}";
+    std::string const expected_arrays = "{a:#skip:b:[skipped]skip:c:#skip:d:\"x\"skip:skip:}";
+    for(std::size_t chunk : chunk_sizes)
+    {
+        BOOST_TEST(skip_trace<bits>(str, false, chunk) == expected);
+        BOOST_TEST(skip_trace<bits>(str, true, chunk) == expected_arrays);
+        BOOST_TEST(skip_trace<table>(str, true, chunk) == expected_arrays);
+        BOOST_TEST(skip_trace<bits>("[1,[2,[3]],{\"a\":[]}]", true, chunk) == "[skipped]");
+        BOOST_TEST(skip_trace<bits>("{\"skip\":{\"a\":[1,2}", false, chunk) == "error");
+        BOOST_TEST(skip_trace<bits>("{\"skip\":}", false, chunk) == "error");
+        BOOST_TEST(skip_trace<bits>("{\"skip\":12 }", false, chunk) == "{skip:}");
+    }
+    BOOST_TEST(structural_skip_trace(str, false) == expected);
+    BOOST_TEST(structural_skip_trace(str, true) == expected_arrays);
+    BOOST_TEST(structural_skip_trace("[1,[2,[3]],{\"a\":[]}]", true) == "[skipped]");
+    BOOST_TEST(structural_skip_trace("{\"skip\":{\"a\":[1,2}", false) == "error");
+    BOOST_TEST(structural_skip_trace("{\"skip\":}", false) == "error");
+
+    std::string docs = "[1] {\"skip\":[2]}";
+    std::vector<char> buf{docs.begin(), docs.end()};
+    bits parser;
+    parser.skip_arrays = true;
+    auto res = parser.consume_document(buf.data(), buf.data() + buf.size());
+    BOOST_TEST(res.first);
+    BOOST_TEST(res.second == 3u);
+    BOOST_TEST(parser.trace == "[skipped]");
+    parser.reset();
+    res = parser.consume_document(buf.data() + res.second, buf.data() + buf.size());
+    BOOST_TEST(res.first);
+    BOOST_TEST(parser.complete_without_error());
+    BOOST_TEST(parser.trace == "{skip:}");
+}
+
+BOOST_AUTO_TEST_CASE(projection, *utf::description("The projection builder shall only build the values selected by JSON Pointers"))
+{
+    jbc::json::projection paths;
+    BOOST_TEST(paths.add("/a"));
+    BOOST_TEST(paths.add("/b/c"));
+    BOOST_TEST(paths.add("/items/1/name"));
+    BOOST_TEST(paths.add("/x~1y"));
+    BOOST_TEST(!paths.add("a"));
+    BOOST_TEST(!paths.add("/b/~2"));
+    std::string const str = R"json({"z":[1,{"a":2}],"a":{"deep":[1,2,{"k":"v"}]},"b":{"c":"kept","d":"dropped","e":{}},
+        "items":[{"name":"first","id":1},{"id":2,"name":"second","tags":["x"]},{"name":"third"}],"x/y":true,"x~y":false})json";
+    auto check = [](jbc::json::stl_item& i) {
+        BOOST_TEST(i.child_count() == 4);
+        BOOST_TEST(i.property("z") == nullptr);
+        BOOST_TEST(i.property("a")->property("deep")->item(2)->property("k")->string_value() == "v");
+        BOOST_TEST(i.property("b")->child_count() == 1);
+        BOOST_TEST(i.property("b")->property("c")->string_value() == "kept");
+        auto items = i.property("items");
+        BOOST_TEST(items->child_count() == 2);
+        BOOST_TEST((items->item(0)->type() == jbc::json::ItemType::Null));
+        BOOST_TEST(items->item(1)->child_count() == 1);
+        BOOST_TEST(items->item(1)->property("name")->string_value() == "second");
+        BOOST_TEST(i.property("x/y")->bool_value());
+    };
+    for(std::size_t chunk : chunk_sizes)
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        jbc::json::stl_projection_parser parser;
+        parser.set_projection(&paths);
+        BOOST_TEST(consume_chunks(parser, buf, chunk));
+        jbc::json::stl_item i;
+        parser.moveTo(i);
+        check(i);
+    }
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::stl_item i;
+    BOOST_TEST(jbc::json::parse_projected(buf.data(), buf.data() + buf.size(), paths, i));
+    check(i);
+
+    using structural = jbc::json::structural_parser<jbc::json::stdvector, jbc::json::stl_projection_builder, std::vector<char>, char>;
+    structural parser;
+    parser.set_projection(&paths);
+    BOOST_TEST(parser.parse(buf.data(), buf.data() + buf.size()));
+    parser.moveTo(i);
+    check(i);
+
+    jbc::json::projection everything;
+    BOOST_TEST(everything.add(""));
+    BOOST_TEST(jbc::json::parse_projected(buf.data(), buf.data() + buf.size(), everything, i));
+    BOOST_TEST(i.child_count() == 6);
+    BOOST_TEST(i.property("items")->item(2)->property("name")->string_value() == "third");
+
+    std::string const invalid = R"json({"skipped":[1,}],"a":1})json";
+    std::vector<char> bad{invalid.begin(), invalid.end()};
+    BOOST_TEST(!jbc::json::parse_projected(bad.data(), bad.data() + bad.size(), paths, i));
+}
+
+BOOST_AUTO_TEST_CASE(lazy_document, *utf::description("The lazy document shall decode values on access, and reject invalid structures"))
+{
+    std::string const str = R"json({"user" : {"id" : 42, "name" : "Jérôme \"jb\"", "tags" : ["a", "b", []]},
+        "ratio" : -2.5e3, "ok" : true, "ko" : false, "none" : null, "escaped" : "x", "bad" : 01, "empty" : {}})json";
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::lazy_document doc;
+    BOOST_TEST(doc.parse(buf.data(), buf.data() + buf.size()));
+    BOOST_TEST(doc.error_message() == nullptr);
+    BOOST_TEST(doc["user"]["id"].integer_value().second == 42);
+    BOOST_TEST(doc["user"]["id"].double_value().second == 42.);
+    BOOST_TEST(doc["user"]["name"].string_value().second == u8"Jérôme \"jb\"");
+    BOOST_TEST((doc["user"]["tags"].type() == jbc::json::ItemType::Array));
+    BOOST_TEST(doc["user"]["tags"].child_count() == 3);
+    BOOST_TEST(doc["user"]["tags"][1].string_value().second == "b");
+    BOOST_TEST(doc["user"]["tags"][2].child_count() == 0);
+    BOOST_TEST(!doc["user"]["tags"][3].exists());
+    BOOST_TEST(doc["ratio"].double_value().second == -2500.);
+    BOOST_TEST(!doc["ratio"].integer_value().first);
+    BOOST_TEST(doc["ok"].bool_value().second);
+    BOOST_TEST(doc["ko"].bool_value().first);
+    BOOST_TEST(!doc["ko"].bool_value().second);
+    BOOST_TEST((doc["none"].type() == jbc::json::ItemType::Null));
+    BOOST_TEST(doc["none"].exists());
+    BOOST_TEST(doc["escaped"].string_value().second == "x");
+    BOOST_TEST(!doc["missing"].exists());
+    BOOST_TEST(!doc["missing"]["deeper"][0].exists());
+    BOOST_TEST(!doc["ok"].string_value().first);
+    BOOST_TEST(!doc["bad"].double_value().first); // numbers are checked when decoded
+    BOOST_TEST(doc.error_message() != nullptr);
+    BOOST_TEST(doc["empty"].child_count() == 0);
+    BOOST_TEST(doc.root().child_count() == 8);
+
+    std::string keys;
+    for(auto it = doc.root().begin(); it != doc.root().end(); ++it)
+        keys += std::string(it.key().second) + ",";
+    BOOST_TEST(keys == "user,ratio,ok,ko,none,escaped,bad,empty,");
+    std::string tags;
+    for(jbc::json::lazy_value v : doc["user"]["tags"])
+        tags += v.string_value().first ? std::string(v.string_value().second) : "[]";
+    BOOST_TEST(tags == "ab[]");
+
+    for(std::string invalid : {"", "1", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "[tru]", "[truex]", "[\"abc]", "[1] [2]",
+                               "[[1]", "{\"a\":1]", "[1 2]", "{\"a\"}"})
+    {
+        std::vector<char> bad{invalid.begin(), invalid.end()};
+        BOOST_TEST(!doc.parse(bad.data(), bad.data() + bad.size()), invalid);
+        BOOST_TEST(doc.error_message() != nullptr);
+        BOOST_TEST(!doc.root().exists());
+    }
+    std::string const text = "\"top \\n level\"";
+    std::vector<char> top{text.begin(), text.end()};
+    BOOST_TEST(doc.parse(top.data(), top.data() + top.size()));
+    BOOST_TEST(doc.root().string_value().second == "top \n level");
+    BOOST_TEST(doc.tape_size() == 1u);
+}
+
+namespace
+{
+struct BoundPoint
+{
+    double x = 0.;
+    double y = 0.;
+};
+
+struct BoundMessage
+{
+    int id = 0;
+    bool active = false;
+    std::string name;
+    BoundPoint origin;
+    std::vector<BoundPoint> points;
+    std::vector<std::string> tags;
+    unsigned short small = 7;
+};
+
+struct StaticMessage
+{
+    int id = 0;
+    boost::container::static_vector<char, 8> name;
+    boost::container::static_vector<BoundPoint, 2> points;
+};
+
+template<typename T>
+bool parse_chunked(std::string const& str, T& destination, std::size_t chunk)
+{
+    using parser_type = jbc::json::parser_bits<jbc::json::stdvector, jbc::json::struct_binder<jbc::json::stdvector, T>,
+        std::vector<char>, char>;
+    parser_type parser;
+    bool const good = consume_chunks(parser, str, chunk);
+    parser.moveTo(destination);
+    return good;
+}
+}
+
+namespace jbc
+{
+namespace json
+{
+template<> struct json_binding<BoundPoint>
+{
+    static constexpr auto fields = std::make_tuple(json_field("x", &BoundPoint::x), json_field("y", &BoundPoint::y));
+};
+
+template<> struct json_binding<BoundMessage>
+{
+    static constexpr auto fields = std::make_tuple(json_field("id", &BoundMessage::id), json_field("active", &BoundMessage::active),
+        json_field("name", &BoundMessage::name), json_field("origin", &BoundMessage::origin), json_field("points", &BoundMessage::points),
+        json_field("tags", &BoundMessage::tags), json_field("small", &BoundMessage::small));
+};
+
+template<> struct json_binding<StaticMessage>
+{
+    static constexpr auto fields = std::make_tuple(json_field("id", &StaticMessage::id), json_field("name", &StaticMessage::name),
+        json_field("points", &StaticMessage::points));
+};
+}
+}
+
+BOOST_AUTO_TEST_CASE(struct_binding, *utf::description("Bound structs shall be written straight from the document"))
+{
+    static_assert(jbc::json::binding_detail::bound_struct<BoundMessage>::table.find("tags") == 5);
+    static_assert(jbc::json::binding_detail::bound_struct<BoundMessage>::table.find("tag") == 7);
+    std::string const str = R"json({"id" : 42, "unknown" : {"id" : [1, {"x" : 3}]}, "name" : "né\"x", "active" : true,
+        "origin" : {"y" : -1.5, "z" : "ignored", "x" : 2}, "points" : [{"x" : 1}, {"y" : 2}, {}],
+        "tags" : ["a", "bc"], "small" : null, "a key longer than the longest bound key, which is skipped" : 1})json";
+    for(std::size_t chunk : chunk_sizes)
+    {
+        BoundMessage m;
+        BOOST_TEST(parse_chunked(str, m, chunk));
+        BOOST_TEST(m.id == 42);
+        BOOST_TEST(m.active);
+        BOOST_TEST(m.name == u8"né\"x");
+        BOOST_TEST(m.origin.x == 2.);
+        BOOST_TEST(m.origin.y == -1.5);
+        BOOST_TEST(m.points.size() == 3u);
+        BOOST_TEST(m.points[0].x == 1.);
+        BOOST_TEST(m.points[1].y == 2.);
+        BOOST_TEST(m.tags.size() == 2u);
+        BOOST_TEST(m.tags[1] == "bc");
+        BOOST_TEST(m.small == 7u);
+    }
+    std::vector<char> buf{str.begin(), str.end()};
+    BoundMessage m;
+    BOOST_TEST(jbc::json::parse_struct(buf.data(), buf.data() + buf.size(), m));
+    BOOST_TEST(m.tags[0] == "a");
+
+    // integral members are read from the digits, by both parsers
+    std::string const limits = R"json({"id" : -2147483648, "small" : 65535})json";
+    for(std::size_t chunk : chunk_sizes)
+    {
+        BOOST_TEST(parse_chunked(limits, m, chunk));
+        BOOST_TEST(m.id == std::numeric_limits<int>::min());
+        BOOST_TEST(m.small == 65535u);
+    }
+    jbc::json::structural_parser<jbc::json::stdvector, jbc::json::struct_binder<jbc::json::stdvector, BoundMessage>,
+        std::vector<char>, char> structural;
+    std::vector<char> limits_buf{limits.begin(), limits.end()};
+    BOOST_TEST(structural.parse(limits_buf.data(), limits_buf.data() + limits_buf.size()));
+    structural.moveTo(m);
+    BOOST_TEST(m.id == std::numeric_limits<int>::min());
+
+    for(std::string invalid : {"[]", "{\"id\" : \"text\"}", "{\"id\" : 1.5}", "{\"small\" : -1}", "{\"small\" : 70000}",
+                               "{\"id\" : 2147483648}", "{\"small\" : 18446744073709551616}",
+                               "{\"name\" : 1}", "{\"points\" : {}}", "{\"origin\" : []}", "{\"tags\" : [1]}", "{\"id\" : 1"})
+    {
+        BOOST_TEST(!parse_chunked(invalid, m, 1000), invalid);
+    }
+
+    StaticMessage s;
+    using static_parser = jbc::json::parser_bits<jbc::json::static_vector, jbc::json::struct_binder<jbc::json::static_vector, StaticMessage>,
+        jbc::json::static_types::buffer_type, char>;
+    std::string const static_str = R"json({"id" : 3, "name" : "short", "points" : [{"x" : 1}, {"x" : 2}]})json";
+    std::vector<char> static_buf{static_str.begin(), static_str.end()};
+    static_parser parser;
+    BOOST_TEST((parser.consume(static_buf.data(), static_buf.data() + static_buf.size()) && parser.end()));
+    parser.moveTo(s);
+    BOOST_TEST(s.id == 3);
+    BOOST_TEST(std::string(s.name.begin(), s.name.end()) == "short");
+    BOOST_TEST(s.points.size() == 2u);
+    BOOST_TEST(s.points[1].x == 2.);
+    for(std::string overflow : {R"json({"name" : "too long for 8"})json", R"json({"points" : [{}, {}, {}]})json"})
+    {
+        std::vector<char> overflow_buf{overflow.begin(), overflow.end()};
+        parser.reset();
+        BOOST_TEST(!(parser.consume(overflow_buf.data(), overflow_buf.data() + overflow_buf.size()) && parser.end()), overflow);
+    }
+}
+
+namespace
+{
+class NumberCounter
+{
+public:
+    int numbers = 0;
+protected: // as callbacks policies declare them
+    bool double_handler(double) { ++numbers; return true; }
+    bool integer_handler(int64_t) { ++numbers; return true; }
+};
+}
+
+BOOST_AUTO_TEST_CASE(runtime_handler, *utf::description("Handlers chosen at runtime shall get the same events as callbacks policies"))
+{
+    using runtime_parser = jbc::json::parser<jbc::json::stdvector, std::vector<char> >;
+    std::string const str = "{\"a\":1,\"skip\":{\"x\":[1,\"]}\\\"\",{\"y\":2}],\"z\":\"}\"},\"b\":[true, null],"
+                            "\"skip\" : \"str\\\"ing]\",\"c\":-1.5e3,\"skip\":123,\"d\":\"x\",\"skip\":[],\"skip\":false}";
+    for(std::size_t chunk : chunk_sizes)
+    {
+        runtime_parser parser;
+        SkippingHandler handler;
+        handler.skip_arrays = true;
+        parser.set_handler(handler);
+        BOOST_TEST(consume_chunks(parser, str, chunk));
+        BOOST_TEST(handler.trace == "{a:#skip:b:[skipped]skip:c:#skip:d:\"x\"skip:skip:}");
+
+        runtime_parser counting;
+        NumberCounter counter;
+        counting.set_handler(counter);
+        BOOST_TEST(consume_chunks(counting, "[1,{\"a\":[2.5,\"3\",true,null]},-4e2]", chunk));
+        BOOST_TEST(counter.numbers == 3);
+
+        runtime_parser building;
+        jbc::json::stl_item_builder builder;
+        building.set_handler(builder);
+        BOOST_TEST(consume_chunks(building, "{\"a\":[1,\"b\",null]}", chunk));
+        jbc::json::stl_item built;
+        builder.moveTo(built);
+        BOOST_TEST(built.property("a")->item(0)->double_value() == 1.);
+        BOOST_TEST(built.property("a")->item(1)->string_value() == "b");
+
+        runtime_parser validating;
+        BOOST_TEST(consume_chunks(validating, str, chunk));
+        runtime_parser invalid;
+        BOOST_TEST(!consume_chunks(invalid, "{\"a\":[1,2}", chunk));
+    }
+
+    // a table written by hand, failing on the second string
+    using events = runtime_parser::events_type;
+    static constexpr events failing = [] {
+        events e;
+        e.string_content = [](void* context, std::string_view) { return ++*static_cast<int*>(context) < 2; };
+        return e;
+    }();
+    int strings = 0;
+    runtime_parser parser;
+    parser.set_handler(&failing, &strings);
+    BOOST_TEST(!consume_chunks(parser, "[\"a\",\"b\",\"c\"]", 1000));
+    BOOST_TEST(strings == 2);
+}
+
+namespace
+{
+/**
+ * @brief pull_trace feeds str to a pull reader by chunks, and writes the events read
+ */
+std::string pull_trace(std::string const& str, std::size_t chunk, bool finish = true)
+{
+    using jbc::json::pull_event;
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::pull_reader reader;
+    std::string trace;
+    // reads the events until more input is needed, false when the document is complete or in error
+    auto read = [&reader, &trace]() {
+        for(;;)
+        {
+            jbc::json::pull_token token = reader.next();
+            switch(token.type)
+            {
+            case pull_event::need_more_input: return true;
+            case pull_event::begin_array: trace += "[ "; break;
+            case pull_event::end_array: trace += "]"; break;
+            case pull_event::begin_object: trace += "{ "; break;
+            case pull_event::end_object: trace += "}"; break;
+            case pull_event::key: trace += std::string(token.text) + ": "; break;
+            case pull_event::string: trace += "\"" + std::string(token.text) + "\" "; break;
+            case pull_event::number: trace += std::to_string(static_cast<int>(token.number)) + " "; break;
+            case pull_event::integer: trace += std::to_string(token.integer) + " "; break;
+            case pull_event::boolean: trace += token.boolean ? "t " : "f "; break;
+            case pull_event::null: trace += "n "; break;
+            case pull_event::end_of_document: return false;
+            case pull_event::error: trace += "error"; return false;
+            }
+        }
+    };
+    bool const more = feed_chunks(buf, chunk, [&reader, &read](char* begin, char* end) {
+        std::vector<char> part(begin, end); // reused by the caller
+        reader.feed(part.data(), part.data() + part.size());
+        return read();
+    });
+    if(more && !finish)
+        return trace + "...";
+    if(more)
+    {
+        reader.finish();
+        if(read())
+            return trace + "unexpected need_more_input";
+    }
+    return trace;
+}
+}
+
+BOOST_AUTO_TEST_CASE(pull_reader, *utf::description("The pull reader shall return the events of documents fed by parts"))
+{
+    std::string const str = "{\"a\":1,\"long key\":[\"x\\\"y\\u00e9\",true,null,{}],\"b\":-25,\"c\":false}";
+    std::string const expected = "{ a: 1 long key: [ \"x\"y\xc3\xa9\" t n { }]b: -25 c: f }";
+    for(std::size_t chunk : chunk_sizes)
+    {
+        BOOST_TEST(pull_trace(str, chunk) == expected);
+        BOOST_TEST(pull_trace("[1,2", chunk, false) == "[ 1 ..."); // 2 can go on
+        BOOST_TEST(pull_trace("[1,2", chunk) == "[ 1 error");
+        BOOST_TEST(pull_trace("[1,\"a\"}", chunk) == "[ 1 \"a\" error");
+        BOOST_TEST(pull_trace("[]", chunk) == "[ ]");
+    }
+
+    // events left unread when feeding again are kept
+    std::string doc = "[\"first\",\"second\"]";
+    std::vector<char> buf{doc.begin(), doc.end()};
+    jbc::json::pull_reader reader;
+    BOOST_TEST(reader.feed(buf.data(), buf.data() + 5));
+    BOOST_TEST(reader.feed(buf.data() + 5, buf.data() + buf.size()));
+    BOOST_TEST((reader.next().type == jbc::json::pull_event::begin_array));
+    BOOST_TEST(reader.next().text == "first");
+    BOOST_TEST(reader.next().text == "second");
+    BOOST_TEST((reader.next().type == jbc::json::pull_event::end_array));
+    BOOST_TEST((reader.next().type == jbc::json::pull_event::end_of_document));
+    reader.reset();
+    BOOST_TEST((reader.next().type == jbc::json::pull_event::need_more_input));
+    BOOST_TEST(!reader.feed(buf.data() + buf.size() - 1, buf.data() + buf.size()));
+    BOOST_TEST((reader.next().type == jbc::json::pull_event::error));
+    BOOST_TEST(reader.error_message() != nullptr);
+}
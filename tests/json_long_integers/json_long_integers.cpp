@@ -0,0 +1,199 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef JSON_USE_LONG_INTEGERS
+#error This test must be compiled with JSON_USE_LONG_INTEGERS
+#endif
+
+#include <stl_json.h>
+#include <output.h>
+#include <pull_reader.h>
+#include <struct_output.h>
+
+#include <limits>
+#include <sstream>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE json_long_integers
+#include <boost/test/unit_test.hpp>
+
+namespace utf = boost::unit_test;
+
+using json_output = jbc::json::output<char, jbc::json::basic_locator>;
+
+BOOST_AUTO_TEST_CASE(integers, *utf::description("Integers shall be stored as integers, without precision loss"))
+{
+    std::string str = R"json([0, -0, 42, -42, 9007199254740993, 9223372036854775807, -9223372036854775808, 1.5, 2e3])json";
+    std::istringstream s(str);
+    jbc::json::stl_item i;
+    bool res = parse_from_stream(s, i);
+    BOOST_TEST(res);
+    BOOST_TEST(i.child_count() == 9);
+    BOOST_TEST((i.item(0)->type() == jbc::json::ItemType::Integer));
+    BOOST_TEST(i.item(0)->integer_value() == 0);
+    BOOST_TEST(i.item(1)->integer_value() == 0);
+    BOOST_TEST(i.item(2)->integer_value() == 42);
+    BOOST_TEST(i.item(3)->integer_value() == -42);
+    BOOST_TEST(i.item(4)->integer_value() == 9007199254740993);
+    BOOST_TEST(i.item(5)->integer_value() == std::numeric_limits<std::int64_t>::max());
+    BOOST_TEST(i.item(6)->integer_value() == std::numeric_limits<std::int64_t>::min());
+    BOOST_TEST((i.item(7)->type() == jbc::json::ItemType::Double));
+    BOOST_TEST(i.item(7)->double_value() == 1.5);
+    BOOST_TEST((i.item(8)->type() == jbc::json::ItemType::Double));
+    BOOST_TEST(i.item(8)->double_value() == 2000.);
+}
+
+BOOST_AUTO_TEST_CASE(integeroverflow, *utf::description("Integers that do not fit in 64 bits shall be read as double"))
+{
+    std::string str = R"json({"big" : 123456789012345678901234, "small" : -9223372036854775809})json";
+    std::istringstream s(str);
+    jbc::json::stl_item i;
+    bool res = parse_from_stream(s, i);
+    BOOST_TEST(res);
+    BOOST_TEST((i.property("big")->type() == jbc::json::ItemType::Double));
+    BOOST_TEST(i.property("big")->double_value() == 123456789012345678901234.);
+    BOOST_TEST((i.property("small")->type() == jbc::json::ItemType::Double));
+}
+
+BOOST_AUTO_TEST_CASE(invalidintegers, *utf::description("Invalid integers shall be rejected"))
+{
+    for(std::string str : {"[-]", "[1-2]", "[--1]", "[1+]"})
+    {
+        std::istringstream s(str);
+        jbc::json::stl_item i;
+        BOOST_TEST(!parse_from_stream(s, i), str);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(chunkedintegers, *utf::description("Integers split at any position across buffers shall be read identically"))
+{
+    std::string str = R"json([1234567890123456789,-77,5])json";
+    for(size_t split = 0; split <= str.size(); ++split)
+    {
+        std::vector<char> buf{str.begin(), str.end()};
+        jbc::json::stl_parser parser;
+        bool res = parser.consume(buf.data(), buf.data() + split);
+        res = res && parser.consume(buf.data() + split, buf.data() + buf.size());
+        res = res && parser.end();
+        BOOST_TEST(res);
+        jbc::json::stl_item i;
+        parser.moveTo(i);
+        BOOST_TEST(i.item(0)->integer_value() == 1234567890123456789);
+        BOOST_TEST(i.item(1)->integer_value() == -77);
+        BOOST_TEST(i.item(2)->integer_value() == 5);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(structuralintegers, *utf::description("The structural parser shall store integers as integers"))
+{
+    std::string str = R"json([9007199254740993, -1, 0.25])json";
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::stl_item i;
+    BOOST_TEST(jbc::json::parse_from_buffer(buf.data(), buf.data() + buf.size(), i));
+    BOOST_TEST(i.item(0)->integer_value() == 9007199254740993);
+    BOOST_TEST(i.item(1)->integer_value() == -1);
+    BOOST_TEST(i.item(2)->double_value() == 0.25);
+}
+
+BOOST_AUTO_TEST_CASE(integeroutput, *utf::description("Output an integer that does not fit, in two parts"))
+{
+    json_output o;
+    std::array<char, 10> buf;
+    jbc::json::basic_locator loc;
+    int offset = 2;
+    bool res = o.integer(-9223372036854775807 - 1, loc, buf, offset);
+    BOOST_TEST(!res);
+    BOOST_TEST(offset == 10);
+    BOOST_TEST(memcmp(buf.data() + 2, "-9223372", 8) == 0);
+    offset = 0;
+    res = o.integer(-9223372036854775807 - 1, loc, buf, offset);
+    BOOST_TEST(!res);
+    BOOST_TEST(offset == 10);
+    BOOST_TEST(memcmp(buf.data(), "0368547758", 10) == 0);
+    offset = 0;
+    res = o.integer(-9223372036854775807 - 1, loc, buf, offset);
+    BOOST_TEST(res);
+    BOOST_TEST(offset == 2);
+    BOOST_TEST(memcmp(buf.data(), "08", 2) == 0);
+    BOOST_TEST(loc.position == 0);
+}
+
+BOOST_AUTO_TEST_CASE(roundtrip, *utf::description("Integers shall be output exactly"))
+{
+    std::string str = R"json({"id":9007199254740993,"count":-12,"ratio":0.5})json";
+    std::istringstream s(str);
+    jbc::json::stl_item i;
+    BOOST_TEST(parse_from_stream(s, i));
+    std::ostringstream out;
+    bool res = jbc::json::output_json<std::ostringstream, char>(out, i);
+    BOOST_TEST(res);
+    BOOST_TEST(out.str() == str);
+}
+
+BOOST_AUTO_TEST_CASE(pullintegers, *utf::description("The pull reader shall return integers as integers"))
+{
+    std::string str = "[9223372036854775807,-1.5]";
+    std::vector<char> buf{str.begin(), str.end()};
+    jbc::json::pull_reader reader;
+    BOOST_TEST(reader.feed(buf.data(), buf.data() + buf.size()));
+    BOOST_TEST((reader.next().type == jbc::json::pull_event::begin_array));
+    jbc::json::pull_token token = reader.next();
+    BOOST_TEST((token.type == jbc::json::pull_event::integer));
+    BOOST_TEST(token.integer == std::numeric_limits<int64_t>::max());
+    token = reader.next();
+    BOOST_TEST((token.type == jbc::json::pull_event::number));
+    BOOST_TEST(token.number == -1.5);
+}
+
+namespace
+{
+struct WideIntegers
+{
+    std::int64_t signed_max = 0;
+    std::int64_t signed_min = 0;
+    std::uint64_t above = 0;
+    std::uint64_t unsigned_max = 0;
+};
+}
+
+namespace jbc
+{
+namespace json
+{
+template<> struct json_binding<WideIntegers>
+{
+    static constexpr auto fields = std::make_tuple(json_field("signed_max", &WideIntegers::signed_max),
+        json_field("signed_min", &WideIntegers::signed_min), json_field("above", &WideIntegers::above),
+        json_field("unsigned_max", &WideIntegers::unsigned_max));
+};
+}
+}
+
+BOOST_AUTO_TEST_CASE(structintegers, *utf::description("Bound 64 bits members shall be written and read back exactly, with long integers"))
+{
+    WideIntegers const w{std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min(),
+                         9223372036854775809u, std::numeric_limits<std::uint64_t>::max()};
+    std::ostringstream stream;
+    BOOST_TEST(jbc::json::output_struct<jbc::json::stl_types>(stream, w));
+    std::string const text = stream.str();
+    BOOST_TEST(text == R"json({"signed_max":9223372036854775807,"signed_min":-9223372036854775808,)json"
+                       R"json("above":9223372036854775809,"unsigned_max":18446744073709551615})json");
+    std::vector<char> buf{text.begin(), text.end()};
+    WideIntegers back;
+    BOOST_TEST(jbc::json::parse_struct(buf.data(), buf.data() + buf.size(), back));
+    BOOST_TEST(back.signed_max == w.signed_max);
+    BOOST_TEST(back.signed_min == w.signed_min);
+    BOOST_TEST(back.above == w.above);
+    BOOST_TEST(back.unsigned_max == w.unsigned_max);
+
+    // out of range, or a double that can not tell neighbouring integers apart
+    for(std::string invalid : {R"({"signed_max":9223372036854775808})", R"({"signed_min":-9223372036854775809})",
+                               R"({"above":-1})", R"({"unsigned_max":18446744073709551616})",
+                               R"({"signed_max":9007199254740993.0})", R"({"above":1e19})"})
+    {
+        std::vector<char> bad{invalid.begin(), invalid.end()};
+        BOOST_TEST(!jbc::json::parse_struct(bad.data(), bad.data() + bad.size(), back), invalid);
+    }
+}
@@ -5,6 +5,9 @@
 
 #include <stl_json.h>
 #include <output.h>
+#include <struct_output.h>
+#include <limits>
+#include <sstream>
 
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE json_conformance
@@ -623,3 +626,123 @@ BOOST_AUTO_TEST_CASE(complexdocument, *utf::description("Output of a complex doc
         BOOST_TEST(output == R"json(["JSON Test Pattern pass1",{"object with 1 member":["array with 1 element"]},{},[],-42,true,false,null,{"integer":1234567890,"real":-9876.54321,"e":1.23456789e-13,"E":1.23456789e+34,"":2.345678901e+76,"zero":0,"one":1,"space":" ","quote":"\"","backslash":"\\","controls":"\b\f\n\r\t","slash":"/ & /","alpha":"abcdefghijklmnopqrstuvwyz","ALPHA":"ABCDEFGHIJKLMNOPQRSTUVWYZ","digit":"0123456789","0123456789":"digit","special":"`1~!@#$%^&*()_+-={':[,]}|;.</>?","hex":"\u0123\u4567\u89AB\uCDEF\uABCD\uEF4A","true":true,"false":false,"null":null,"array":[],"object":{},"address":"50 St. James Street","url":"http://www.JSON.org/","comment":"// /* <!-- --","# -- --> */":" "," s p a c e d ":[1,2,3,4,5,6,7],"compact":[1,2,3,4,5,6,7],"jsontext":"{\"object with 1 member\":[\"array with 1 element\"]}","quotes":"&#34; \" %22 0x22 034 &#x22;","/\\\"\uCAFE\uBABE\uAB98\uFCDE\uBCDA\uEF4A\b\f\n\r\t`1~!@#$%^&*()_+-=[]{}|;:',./<>?":"A key can be any string"},0.5,98.6,99.44,1066,10,1,0.1,1,2,2,"rosebud"])json");
     }
 }
+
+namespace
+{
+struct Reply
+{
+    int code = 0;
+    bool cached = false;
+    double ratio = 0.;
+    std::string message;
+    std::vector<int> values;
+    std::vector<Reply> children;
+};
+
+struct WideIntegers
+{
+    std::int64_t signed_max = 0;
+    std::int64_t signed_min = 0;
+    std::uint64_t above = 0;
+    std::uint64_t unsigned_max = 0;
+};
+}
+
+namespace jbc
+{
+namespace json
+{
+template<> struct json_binding<Reply>
+{
+    static constexpr auto fields = std::make_tuple(json_field("code", &Reply::code), json_field("cached", &Reply::cached),
+        json_field("ratio", &Reply::ratio), json_field("msg \"quoted\"", &Reply::message),
+        json_field("values", &Reply::values), json_field("children", &Reply::children));
+};
+
+template<> struct json_binding<WideIntegers>
+{
+    static constexpr auto fields = std::make_tuple(json_field("signed_max", &WideIntegers::signed_max),
+        json_field("signed_min", &WideIntegers::signed_min), json_field("above", &WideIntegers::above),
+        json_field("unsigned_max", &WideIntegers::unsigned_max));
+};
+}
+}
+
+BOOST_AUTO_TEST_CASE(structoutput, *utf::description("Output of a bound struct, in buffers of any size"))
+{
+    static_assert(jbc::json::binding_detail::key_literal<Reply, 3>::size == 18);
+    Reply r{200, true, 0.5, "a \"b\"\n", {1, -2, 3}, {Reply{1, false, -1.5, "", {}, {}}, Reply{}}};
+    std::string const expected = R"json({"code":200,"cached":true,"ratio":0.5,"msg \"quoted\"":"a \"b\"\n","values":[1,-2,3],)json"
+        R"json("children":[{"code":1,"cached":false,"ratio":-1.5,"msg \"quoted\"":"","values":[],"children":[]},)json"
+        R"json({"code":0,"cached":false,"ratio":0,"msg \"quoted\"":"","values":[],"children":[]}]})json";
+    std::ostringstream stream;
+    BOOST_TEST(jbc::json::output_struct<jbc::json::stl_types>(stream, r));
+    BOOST_TEST(stream.str() == expected);
+    for(std::size_t size : {1, 2, 3, 5, 7, 13})
+    {
+        std::vector<char> buf(size);
+        jbc::json::basic_locator loc;
+        std::string output;
+        bool res = false;
+        for(int steps = 0; !res && steps < 1000; ++steps)
+        {
+            int offset = 0;
+            res = jbc::json::struct_output<jbc::json::stl_types>::value(r, loc, buf, offset);
+            output.append(buf.data(), static_cast<std::size_t>(offset));
+        }
+        BOOST_TEST(res);
+        BOOST_TEST(output == expected, size);
+    }
+
+    std::vector<char> parsed{expected.begin(), expected.end()};
+    Reply back;
+    BOOST_TEST(jbc::json::parse_struct(parsed.data(), parsed.data() + parsed.size(), back));
+    BOOST_TEST(back.message == r.message);
+    BOOST_TEST(back.children.size() == 2u);
+    BOOST_TEST(back.children[0].ratio == -1.5);
+
+    // unsigned values above the largest int64_t
+    std::vector<std::uint64_t> const large{std::numeric_limits<std::uint64_t>::max(), 9223372036854775808u, 5};
+    for(std::size_t size : {1, 2, 3, 7, 100})
+    {
+        std::vector<char> buf(size);
+        jbc::json::basic_locator loc;
+        std::string output;
+        bool res = false;
+        for(int steps = 0; !res && steps < 1000; ++steps)
+        {
+            int offset = 0;
+            res = jbc::json::struct_output<jbc::json::stl_types>::value(large, loc, buf, offset);
+            output.append(buf.data(), static_cast<std::size_t>(offset));
+        }
+        BOOST_TEST(res);
+        BOOST_TEST(output == "[18446744073709551615,9223372036854775808,5]", size);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(structintegers, *utf::description("Bound 64 bits members shall be written and read back exactly"))
+{
+    WideIntegers const w{std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min(),
+                         9223372036854775809u, std::numeric_limits<std::uint64_t>::max()};
+    std::ostringstream stream;
+    BOOST_TEST(jbc::json::output_struct<jbc::json::stl_types>(stream, w));
+    std::string const text = stream.str();
+    BOOST_TEST(text == R"json({"signed_max":9223372036854775807,"signed_min":-9223372036854775808,)json"
+                       R"json("above":9223372036854775809,"unsigned_max":18446744073709551615})json");
+    std::vector<char> buf{text.begin(), text.end()};
+    WideIntegers back;
+    BOOST_TEST(jbc::json::parse_struct(buf.data(), buf.data() + buf.size(), back));
+    BOOST_TEST(back.signed_max == w.signed_max);
+    BOOST_TEST(back.signed_min == w.signed_min);
+    BOOST_TEST(back.above == w.above);
+    BOOST_TEST(back.unsigned_max == w.unsigned_max);
+
+    // out of range, or a double that can not tell neighbouring integers apart
+    for(std::string invalid : {R"({"signed_max":9223372036854775808})", R"({"signed_min":-9223372036854775809})",
+                               R"({"above":-1})", R"({"unsigned_max":18446744073709551616})",
+                               R"({"signed_max":9007199254740993.0})", R"({"above":1e19})"})
+    {
+        std::vector<char> bad{invalid.begin(), invalid.end()};
+        BOOST_TEST(!jbc::json::parse_struct(bad.data(), bad.data() + bad.size(), back), invalid);
+    }
+}
@@ -0,0 +1,473 @@
+//          Copyright Julien Blanc 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lazy_document.h"
+#include "libjson.h"
+#include "ndjson_reader.h"
+#include "parallel_parser.h"
+#include "pull_reader.h"
+#include "read_pipeline.h"
+#include "stl_json.h"
+#include "struct_output.h"
+
+using namespace jbc;
+using namespace json;
+
+/**
+ * @brief The NullHandler struct accepts everything, so that only the parsing itself is measured
+ */
+struct NullHandler {
+    static bool begin_array_handler() { return true; }
+    static bool end_array_handler() { return true; }
+    static bool begin_object_handler() { return true; }
+    static bool end_object_handler() { return true; }
+    static bool boolean_handler(bool /*value*/) { return true; }
+    static bool double_handler(double /*value*/) { return true; }
+    static bool integer_handler(int64_t /*value*/) { return true; }
+    static bool null_handler() { return true; }
+    static bool begin_string_handler() { return true;}
+    static bool string_content_handler(std::string_view /*value*/) { return true; }
+    static bool end_string_handler() { return true; }
+    static bool begin_key_handler() { return true; }
+    static bool key_content_handler(std::string_view /*value*/) { return true; }
+    static bool end_key_handler() { return true; }
+};
+
+/**
+ * @brief The SkippingHandler struct skips every object, so that only the skip of the records is measured
+ */
+struct SkippingHandler : NullHandler {
+    static handler_result begin_object_handler() { return handler_result::skip; }
+};
+
+/**
+ * @brief The Record struct is bound to the records of the synthetic documents
+ */
+struct Record
+{
+    int id = 0;
+    std::string name;
+    bool active = false;
+    std::vector<double> position;
+    std::string description;
+};
+
+namespace jbc
+{
+namespace json
+{
+template<> struct json_binding<Record>
+{
+    static constexpr auto fields = std::make_tuple(json_field("id", &Record::id), json_field("name", &Record::name),
+        json_field("active", &Record::active), json_field("position", &Record::position),
+        json_field("description", &Record::description));
+};
+}
+}
+
+/**
+ * @brief make_document builds a synthetic document : an array of records, either minified or
+ * pretty printed with four spaces indentation. With escaped, the descriptions are non latin text
+ * written with \u escapes only, as produced by many serializers. With utf8, the same text is written as raw
+ * UTF-8
+ */
+std::string make_document(int records, bool pretty, bool escaped = false, bool utf8 = false)
+{
+    std::string nl = pretty ? "\n" : "";
+    auto indent = [pretty](int level) { return pretty ? std::string(4 * level, ' ') : std::string{}; };
+    std::string sep = pretty ? ": " : ":";
+    std::string doc = "[" + nl;
+    for(int i = 0; i < records; ++i)
+    {
+        doc += indent(1) + "{" + nl;
+        doc += indent(2) + "\"id\"" + sep + std::to_string(100000 + i) + "," + nl;
+        doc += indent(2) + "\"name\"" + sep + "\"record number " + std::to_string(i) + "\"," + nl;
+        doc += indent(2) + "\"active\"" + sep + (i % 2 ? "true" : "false") + "," + nl;
+        doc += indent(2) + "\"parent\"" + sep + "null," + nl;
+        doc += indent(2) + "\"position\"" + sep + "[" + nl;
+        doc += indent(3) + "48.8566," + nl + indent(3) + "2.3522" + nl;
+        doc += indent(2) + "]," + nl;
+        doc += indent(2) + "\"description\"" + sep + (escaped ?
+                "\"\\u041f\\u0440\\u0438\\u0432\\u0435\\u0442 \\u043c\\u0438\\u0440, \\u3053\\u3093\\u306b\\u3061\\u306f \\ud83d\\ude00\"" : utf8 ?
+                "\"\u041f\u0440\u0438\u0432\u0435\u0442 \u043c\u0438\u0440, \u3053\u3093\u306b\u3061\u306f \U0001F600\"" :
+                "\"a somewhat longer text value, as found in most payloads\"") + nl;
+        doc += indent(1) + "}" + (i + 1 < records ? "," : "") + nl;
+    }
+    doc += "]" + nl;
+    return doc;
+}
+
+/**
+ * @brief make_ndjson builds a synthetic newline delimited document, one minified record per line
+ */
+std::string make_ndjson(int records)
+{
+    std::string doc;
+    for(int i = 0; i < records; ++i)
+    {
+        std::string record = make_document(1, false);
+        doc.append(record, 1, record.size() - 2); // strip the enclosing array
+        doc += "\n";
+    }
+    return doc;
+}
+
+/**
+ * @brief The validating_parser struct is a parser with UTF-8 validation enabled
+ */
+template<typename parser_type>
+struct validating_parser : parser_type
+{
+    validating_parser() { parser_type::set_utf8_validation(true); }
+};
+
+/**
+ * @brief The runtime_parser struct is a parser whose handler is plugged at runtime, through the events table
+ */
+template<typename handler_type>
+struct runtime_parser : parser<stdvector, std::vector<char> >
+{
+    handler_type handler;
+    runtime_parser() { set_handler(handler); }
+};
+
+/**
+ * @brief The NumberHandler struct only subscribes to numbers, the other events take the null fast path
+ */
+struct NumberHandler
+{
+    double sum = 0;
+    bool double_handler(double value) { sum += value; return true; }
+    bool integer_handler(int64_t value) { sum += static_cast<double>(value); return true; }
+};
+
+template<typename parser_type, bool structural>
+bool parse_once(std::vector<char>& data)
+{
+    parser_type parser;
+    if constexpr(structural)
+        return parser.parse(data.data(), data.data() + data.size());
+    else
+        return parser.consume(data.data(), data.data() + data.size()) && parser.end();
+}
+
+template<typename parser_type, bool structural = false>
+void run(char const* name, std::string const& doc, int iterations)
+{
+    std::vector<char> data{doc.begin(), doc.end()};
+    bool good = parse_once<parser_type, structural>(data); // warm up
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations && good; ++i)
+        good = parse_once<parser_type, structural>(data);
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    double mb = static_cast<double>(data.size()) * iterations / (1024. * 1024.);
+    std::cout << name << " : " << data.size() << " bytes, ";
+    if(good)
+        std::cout << mb / seconds << " MB/s" << std::endl;
+    else
+        std::cout << "parse error" << std::endl;
+}
+
+void run_ndjson(std::string const& doc, int iterations, unsigned int max_threads)
+{
+    std::vector<char> data{doc.begin(), doc.end()};
+    for(unsigned int threads = 1; threads <= max_threads; ++threads)
+    {
+        ndjson_reader reader(threads);
+        std::size_t documents = 0;
+        auto count = [&documents](stl_item&&) { ++documents; return true; };
+        bool good = reader.parse(data.data(), data.data() + data.size(), count); // warm up
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations && good; ++i)
+            good = reader.parse(data.data(), data.data() + data.size(), count);
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop - start).count();
+        double mb = static_cast<double>(data.size()) * iterations / (1024. * 1024.);
+        std::cout << "ndjson, stl_item, " << threads << " thread(s) : " << data.size() << " bytes, ";
+        if(good)
+            std::cout << mb / seconds << " MB/s" << std::endl;
+        else
+            std::cout << "parse error" << std::endl;
+    }
+}
+
+/**
+ * @brief run_lazy parses the document into a lazy_document, and reads the id of every record
+ */
+void run_lazy(char const* name, std::string const& doc, int iterations)
+{
+    std::vector<char> data{doc.begin(), doc.end()};
+    lazy_document document;
+    bool good = true;
+    double sum = 0.;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations && good; ++i)
+    {
+        good = document.parse(data.data(), data.data() + data.size());
+        for(lazy_value record : document.root())
+            sum += record["id"].double_value().second;
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    double mb = static_cast<double>(data.size()) * iterations / (1024. * 1024.);
+    std::cout << name << " : " << data.size() << " bytes, ";
+    if(good && sum > 0.)
+        std::cout << mb / seconds << " MB/s" << std::endl;
+    else
+        std::cout << "parse error" << std::endl;
+}
+
+/**
+ * @brief run_pull feeds the document to a pull reader by blocks of 64KB, and reads every event
+ */
+void run_pull(char const* name, std::string const& doc, int iterations)
+{
+    std::vector<char> data{doc.begin(), doc.end()};
+    std::size_t const block = 64 * 1024;
+    bool good = true;
+    std::size_t events = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations && good; ++i)
+    {
+        pull_reader reader;
+        std::size_t pos = 0;
+        for(pull_token token = reader.next(); token.type != pull_event::end_of_document && good; token = reader.next())
+        {
+            if(token.type == pull_event::need_more_input)
+            {
+                std::size_t const size = std::min(block, data.size() - pos);
+                good = size > 0 && reader.feed(data.data() + pos, data.data() + pos + size);
+                pos += size;
+            }
+            else
+            {
+                good = token.type != pull_event::error;
+                ++events;
+            }
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    double mb = static_cast<double>(data.size()) * iterations / (1024. * 1024.);
+    std::cout << name << " : " << data.size() << " bytes, ";
+    if(good && events > 0)
+        std::cout << mb / seconds << " MB/s" << std::endl;
+    else
+        std::cout << "parse error" << std::endl;
+}
+
+/**
+ * @brief run_output writes the records of the document, once from a stl_item and once from bound structs
+ */
+void run_output(std::string const& doc, int iterations)
+{
+    std::vector<char> data{doc.begin(), doc.end()};
+    stl_item item;
+    std::vector<Record> records;
+    bool good = parse_from_buffer(data.data(), data.data() + data.size(), item) &&
+            parse_struct(data.data(), data.data() + data.size(), records);
+    for(int bound = 0; bound < 2 && good; ++bound)
+    {
+        std::size_t size = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations && good; ++i)
+        {
+            std::ostringstream s;
+            if(bound)
+                good = output_struct<stl_types>(s, records);
+            else
+                good = output_json<std::ostream, char, stl_item>(s, item);
+            size = s.str().size();
+        }
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop - start).count();
+        double mb = static_cast<double>(size) * iterations / (1024. * 1024.);
+        std::cout << (bound ? "output, bound structs : " : "output, stl_item : ") << size << " bytes, ";
+        if(good)
+            std::cout << mb / seconds << " MB/s" << std::endl;
+        else
+            std::cout << "output error" << std::endl;
+    }
+}
+
+/**
+ * @brief run_events parses each line of a newline delimited document as a separate event, building either the
+ * whole events or only the paths selected by projection when it is not null
+ */
+void run_events(char const* name, std::string const& doc, int iterations, projection const* paths)
+{
+    std::vector<char> data{doc.begin(), doc.end()};
+    stl_projection_parser parser;
+    parser.set_projection(paths);
+    bool good = true;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations && good; ++i)
+    {
+        char* line = data.data();
+        char* const end = data.data() + data.size();
+        while(good && line < end)
+        {
+            char* eol = std::find(line, end, '\n');
+            stl_item item;
+            good = parser.consume(line, eol) && parser.end();
+            parser.moveTo(item);
+            parser.reset();
+            line = eol + (eol < end ? 1 : 0);
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    double mb = static_cast<double>(data.size()) * iterations / (1024. * 1024.);
+    std::cout << name << " : " << data.size() << " bytes, ";
+    if(good)
+        std::cout << mb / seconds << " MB/s" << std::endl;
+    else
+        std::cout << "parse error" << std::endl;
+}
+
+template<bool structural>
+void run_small(char const* name, std::string const& doc, int iterations)
+{
+    std::vector<char> data{doc.begin(), doc.end()};
+    int const documents = iterations * 20000;
+    bool good = true;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < documents && good; ++i)
+    {
+        stl_item item;
+        if constexpr(structural)
+            good = parse_from_buffer(data.data(), data.data() + data.size(), item);
+        else
+        {
+            std::istringstream s(doc);
+            good = parse_from_stream(s, item);
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    std::cout << name << " : " << data.size() << " bytes, ";
+    if(good)
+        std::cout << documents / seconds << " documents/s" << std::endl;
+    else
+        std::cout << "parse error" << std::endl;
+}
+
+template<bool pipelined>
+void run_stream(char const* name, std::string const& doc, int iterations)
+{
+    bool good = true;
+    pipeline_statistics statistics;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations && good; ++i)
+    {
+        std::istringstream s(doc);
+        stl_item item;
+        if constexpr(pipelined)
+            good = parse_from_stream_pipelined(s, item, pipeline_options(), &statistics);
+        else
+            good = parse_from_stream(s, item);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    double mb = static_cast<double>(doc.size()) * iterations / (1024. * 1024.);
+    std::cout << name << " : " << doc.size() << " bytes, ";
+    if(!good)
+        std::cout << "parse error" << std::endl;
+    else if(pipelined)
+        std::cout << mb / seconds << " MB/s, last run : " << statistics.reader_stalls << " reader stalls, "
+                  << statistics.parser_stalls << " parser stalls" << std::endl;
+    else
+        std::cout << mb / seconds << " MB/s" << std::endl;
+}
+
+void run_parallel(std::string const& doc, int iterations, unsigned int max_threads)
+{
+    std::vector<char> data{doc.begin(), doc.end()};
+    for(unsigned int threads = 1; threads <= max_threads; ++threads)
+    {
+        stl_item item;
+        bool good = parse_parallel(data.data(), data.data() + data.size(), item, threads); // warm up
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations && good; ++i)
+            good = parse_parallel(data.data(), data.data() + data.size(), item, threads);
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop - start).count();
+        double mb = static_cast<double>(data.size()) * iterations / (1024. * 1024.);
+        std::cout << "minified, stl_item, parallel parser, " << threads << " thread(s) : " << data.size() << " bytes, ";
+        if(good)
+            std::cout << mb / seconds << " MB/s" << std::endl;
+        else
+            std::cout << "parse error" << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int records = 20000;
+    int iterations = 20;
+    if(argc > 1)
+        records = std::stoi(argv[1]);
+    if(argc > 2)
+        iterations = std::stoi(argv[2]);
+    unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    if(argc > 3)
+        max_threads = static_cast<unsigned int>(std::stoi(argv[3]));
+    std::string minified = make_document(records, false);
+    std::string pretty = make_document(records, true);
+    std::string escaped = make_document(records, false, true);
+    std::string utf8 = make_document(records, false, false, true);
+    using null_parser = parser_bits<stdvector, NullHandler, std::vector<char>, char>;
+    using table_null_parser = function_table_parser_bits<stdvector, NullHandler, std::vector<char>, char>;
+    using structural_null_parser = structural_parser<stdvector, NullHandler, std::vector<char>, char>;
+    run<null_parser>("minified, null handler", minified, iterations);
+    run<null_parser>("pretty, null handler", pretty, iterations);
+    run<null_parser>("escaped, null handler", escaped, iterations);
+    run<null_parser>("utf8, null handler", utf8, iterations);
+    run<validating_parser<null_parser> >("minified, null handler, utf8 validation", minified, iterations);
+    run<validating_parser<null_parser> >("utf8, null handler, utf8 validation", utf8, iterations);
+    run<parser_bits<stdvector, SkippingHandler, std::vector<char>, char> >("minified, skipping records", minified, iterations);
+    run<parser_bits<stdvector, SkippingHandler, std::vector<char>, char> >("pretty, skipping records", pretty, iterations);
+    run<runtime_parser<NullHandler> >("minified, null handler, runtime events", minified, iterations);
+    run<runtime_parser<NumberHandler> >("minified, numbers only, runtime events", minified, iterations);
+    run<parser<stdvector, std::vector<char> > >("minified, no handler, runtime events", minified, iterations);
+    run<table_null_parser>("minified, null handler, function table engine", minified, iterations);
+    run<table_null_parser>("pretty, null handler, function table engine", pretty, iterations);
+    run<structural_null_parser, true>("minified, null handler, structural parser", minified, iterations);
+    run<structural_null_parser, true>("pretty, null handler, structural parser", pretty, iterations);
+    run<stl_parser>("minified, stl_item", minified, iterations);
+    run<stl_parser>("pretty, stl_item", pretty, iterations);
+    run<stl_structural_parser, true>("minified, stl_item, structural parser", minified, iterations);
+    run<stl_structural_parser, true>("pretty, stl_item, structural parser", pretty, iterations);
+    run<parser_bits<stdvector, struct_binder<stdvector, std::vector<Record> >, std::vector<char>, char> >(
+                "minified, bound structs", minified, iterations);
+    run_lazy("minified, lazy document, reading ids", minified, iterations);
+    run_pull("minified, pull reader", minified, iterations);
+    run_pull("pretty, pull reader", pretty, iterations);
+    run_lazy("pretty, lazy document, reading ids", pretty, iterations);
+    run_output(minified, iterations);
+    std::string small = make_document(2, false);
+    run_small<true>("small documents, parse_from_buffer", small, iterations);
+    run_small<false>("small documents, parse_from_stream", small, iterations);
+    run_stream<false>("pretty, stl_item, parse_from_stream", pretty, iterations);
+    run_stream<true>("pretty, stl_item, parse_from_stream_pipelined", pretty, iterations);
+    run_parallel(minified, iterations, max_threads);
+    std::string events = make_ndjson(records * 5);
+    run_ndjson(events, iterations, max_threads);
+    projection paths;
+    paths.add("/id");
+    paths.add("/position/1");
+    run_events("ndjson, stl_item, whole events", events, iterations, nullptr);
+    run_events("ndjson, stl_item, projected events", events, iterations, &paths);
+    return 0;
+}
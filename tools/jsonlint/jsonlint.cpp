@@ -5,6 +5,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <vector>
 
 #include "libjson.h"
 #include "stl_json.h"
@@ -53,39 +55,23 @@ struct FakeItemBuilder {
 };
 //	template<typename T> using stdvector=std::vector<T>;
 
-void lint(std::istream& i, std::string const& name)
+/**
+ * @brief lint parses the whole document in a single pass. The position of an error is only computed when there
+ * is one.
+ */
+void lint(char* begin, char* end, std::string const& name)
 {
-    bool good = true;
-    char buf[32768];
-    int currentLine = 0;
-    int currentChar = 0;
     parser_bits<stdvector,FakeItemBuilder,std::vector<char>, char> parser;
-    while(i.good() && good)
-    {
-        i.read(buf, sizeof(buf));
-        int count = i.gcount();
-        for(int i = 0; i < count && good; ++i)
-        {
-            good = parser.consume_(buf + i);
-            if(buf[i] == '\n')
-            {
-                currentLine += 1;
-                currentChar = 0;
-            }
-            else
-                currentChar += 1;
-        }
-        parser.consume_(nullptr);
-    }
-    if(i.eof())
-        good = good && parser.end();
+    bool good = parser.consume(begin, end) && parser.end();
     if(good)
         std::cout << name << " parsed successful";
     else
     {
+        text_position position = parser.error_position(begin, end);
         std::cout << name << " has error ";
         if(parser.error_message())
-            std::cout << parser.error_message() << " at line " << currentLine << ", position " << currentChar;
+            std::cout << parser.error_message();
+        std::cout << " at line " << position.line << ", position " << position.column;
     }
     std::cout << std::endl;
 }
@@ -101,12 +87,19 @@ int main(int argc, char** argv)
         return -1;
     }
     std::string s{argv[1]};
-    std::ifstream f{s};
+    mapped_file mapping{s};
+    if(mapping.is_open())
+    {
+        lint(mapping.begin(), mapping.end(), s);
+        return 0;
+    }
+    std::ifstream f{s, std::ios::binary}; // pipes and other non regular files are read entirely
     if(!f)
     {
         std::cerr << "Cannot read " << argv[1] << std::endl;
         return -1;
     }
-    lint(f,s);
+    std::vector<char> data{std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+    lint(data.data(), data.data() + data.size(), s);
     return 0;
 }